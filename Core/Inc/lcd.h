@@ -13,49 +13,586 @@
 
 #include <stdint.h>
 #include <font.h>
+#include "lcd_panel.h"
+#include "perf.h"
+#include "stm32f4xx_hal.h"
 
 /**
- * @brief Flag indicating whether a DMA transfer is in progress.
- *        Set to 1 when DMA is active, 0 when finished.
+ * @brief Maximum number of displays driven at once, including the default one.
  */
-static volatile uint8_t lcdSpiBusy = 0;
+#ifndef LCD_MAX_DISPLAYS
+#define LCD_MAX_DISPLAYS 2
+#endif
 
-// Dispaly dimensions
-#define LCD_WIDTH 160
-#define LCD_HEIGHT 128
+/**
+ * @brief Wiring of a display: SPI bus, control pins and framebuffer memory.
+ */
+typedef struct {
+	SPI_HandleTypeDef *spi;       ///< SPI bus, its TX DMA stream must be linked (hdmatx) and use half-word data alignment.
+	GPIO_TypeDef *csPort;         ///< Chip select port.
+	uint16_t csPin;               ///< Chip select pin.
+	GPIO_TypeDef *dcPort;         ///< Data/command port.
+	uint16_t dcPin;               ///< Data/command pin.
+	GPIO_TypeDef *rstPort;        ///< Reset port.
+	uint16_t rstPin;              ///< Reset pin.
+	uint16_t tePin;               ///< EXTI pin of the TE output, 0 if not wired.
+	uint16_t *frameBuffer;        ///< Framebuffer memory (a full frame or a band, see lcdBeginFrame()).
+	uint32_t frameBufferPixels;   ///< Size of frameBuffer in pixels.
+} LcdDisplayConfig;
+
+/**
+ * @brief Handle of a display, created by lcdAddDisplay().
+ * @details All lcd* calls operate on the display chosen with lcdSelectDisplay(),
+ * the on-board display (hspi2, LCD_CS/LCD_DC/LCD_RST pins) is selected by default.
+ * Displays on different SPI buses transfer concurrently.
+ */
+typedef struct LcdDisplay LcdDisplay;
+
+/**
+ * @brief Size of the framebuffer in pixels (default: one full 160x128 frame).
+ * @details Panels whose full frame does not fit are rendered in horizontal
+ * bands of LCD_FRAMEBUFFER_PIXELS / width rows, see lcdBeginFrame().
+ */
+#ifndef LCD_FRAMEBUFFER_PIXELS
+#define LCD_FRAMEBUFFER_PIXELS (160 * 128)
+#endif
+
+/**
+ * @brief Native RGB565 color from 8-bit red, green and blue components.
+ * @details A constant expression, usable in static initializers. The
+ * framebuffer holds native values, the byte order of the panel is handled
+ * by the transfer (16-bit SPI frames).
+ */
+#define RGB565(r, g, b)		((uint16_t)((((r) & 0xf8) << 8) | (((g) & 0xfc) << 3) | (((b) & 0xff) >> 3)))
+
+/**
+ * @brief Native RGB565 color from a 0xRRGGBB value, e.g. RGB888_TO_565(0x2080ff).
+ */
+#define RGB888_TO_565(rgb)	RGB565(((rgb) >> 16) & 0xff, ((rgb) >> 8) & 0xff, (rgb) & 0xff)
 
 //Color definitions
-#define BLACK			0x0000
-#define RED				0x00f8
-#define GREEN			0xe007
-#define BLUE			0x1f00
-#define YELLOW			0xe0ff
-#define MAGENTA			0x1ff8
-#define CYAN			0xff07
-#define WHITE			0xffff
+#define BLACK			RGB565(0x00, 0x00, 0x00)
+#define RED				RGB565(0xff, 0x00, 0x00)
+#define GREEN			RGB565(0x00, 0xff, 0x00)
+#define BLUE			RGB565(0x00, 0x00, 0xff)
+#define YELLOW			RGB565(0xff, 0xff, 0x00)
+#define MAGENTA			RGB565(0xff, 0x00, 0xff)
+#define CYAN			RGB565(0x00, 0xff, 0xff)
+#define WHITE			RGB565(0xff, 0xff, 0xff)
+
+/**
+ * @brief When a flush requested by lcdCopy() is sent to the panel.
+ */
+typedef enum {
+	LCD_PRESENT_IMMEDIATE,   /**< Start the transfer right away (default). */
+	LCD_PRESENT_TE_SYNC      /**< Start the transfer on the next tearing effect edge. */
+} LcdPresentMode;
+
+/**
+ * @brief Origin of the tearing effect (vertical sync) events.
+ */
+typedef enum {
+	LCD_TE_SOURCE_PIN,       /**< TE output of the controller wired to LCD_TE_Pin (EXTI). */
+	LCD_TE_SOURCE_SOFTWARE   /**< Periodic event generated by lcdProcess(), for boards without the TE line. */
+} LcdTeSource;
+
+/**
+ * @brief Screen axis moved by hardware scrolling, see lcdSetScrollOffset().
+ */
+typedef enum {
+	LCD_SCROLL_NONE,         /**< The panel cannot scroll. */
+	LCD_SCROLL_HORIZONTAL,   /**< The scan lines are screen columns (MADCTL exchanges rows and columns). */
+	LCD_SCROLL_VERTICAL      /**< The scan lines are screen rows. */
+} LcdScrollAxis;
+
+/**
+ * @brief Reduced power modes of the panel, indexes of lcdPowerEnterPerf and lcdPowerExitPerf.
+ */
+typedef enum {
+	LCD_POWER_IDLE,          /**< 8 color mode, see lcdSetIdleMode(). */
+	LCD_POWER_PARTIAL,       /**< Only a band of scan lines is refreshed, see lcdSetPartialMode(). */
+	LCD_POWER_SLEEP,         /**< Display off, oscillator and booster stopped, see lcdSleep(). */
+	LCD_POWER_MODE_COUNT
+} LcdPowerMode;
+
+/**
+ * @brief Time taken to enter and to leave each power mode, indexed by LcdPowerMode.
+ * @details Idle and partial mode take effect with the next refresh, the time is
+ * the time the command waited for the bus. The sleep times include the settle
+ * delays required by the controller (5 ms after SLPIN, 120 ms after SLPOUT).
+ */
+extern Perf_Counter lcdPowerEnterPerf[LCD_POWER_MODE_COUNT];
+extern Perf_Counter lcdPowerExitPerf[LCD_POWER_MODE_COUNT];
+
+/**
+ * @brief Time a TE synchronized flush waited for the sync edge
+ *        (from lcdCopy() to the start of the transfer).
+ */
+extern Perf_Counter lcdVsyncWaitPerf;
+
+/**
+ * @brief Time drawing calls spent waiting for the DMA to read the rows they modify.
+ */
+extern Perf_Counter lcdScanoutWaitPerf;
+
+/**
+ * @brief Render pipeline stages, see lcdSetPipelined().
+ * @details
+ * - lcdBandRenderPerf: drawing of one band (lcdBeginFrame()/lcdNextBand() to lcdNextBand()), items are rows.
+ * - lcdBandTransferPerf: DMA transfer of one band, items are rows.
+ * - lcdBandStallPerf: time lcdNextBand() waited for a free band buffer.
+ * - lcdFramePerf: lcdBeginFrame() to the end of the transfer of the last band.
+ *
+ * A render time above the transfer time means the CPU is the bottleneck,
+ * a growing stall time means the SPI is.
+ */
+extern Perf_Counter lcdBandRenderPerf;
+extern Perf_Counter lcdBandTransferPerf;
+extern Perf_Counter lcdBandStallPerf;
+extern Perf_Counter lcdFramePerf;
+
+/**
+ * @brief DMA transfers narrowed by lcdCopyRect(), items are pixels.
+ */
+extern Perf_Counter lcdRectTransferPerf;
+
+/**
+ * @brief Axis aligned rectangle in screen coordinates.
+ */
+typedef struct {
+	int x;       ///< X coordinate of the top-left corner.
+	int y;       ///< Y coordinate of the top-left corner.
+	int width;   ///< Width in pixels.
+	int height;  ///< Height in pixels.
+} LcdRect;
+
+/**
+ * @brief Horizontal run of pixels [x0, x1) on one row, empty when x1 <= x0.
+ */
+typedef struct {
+	int16_t x0;  ///< First column inside the span.
+	int16_t x1;  ///< First column after the span.
+} LcdSpan;
+
+/**
+ * @brief Shape mask stored as one span per row.
+ * @details Captured from any filled shape with lcdStencilBegin() /
+ * lcdStencilEnd(). Every row keeps the leftmost and the rightmost pixel
+ * drawn on it, which is exact for rectangles, circles and rounded
+ * rectangles. Use LCD_STENCIL() to define a stencil with its storage.
+ */
+typedef struct {
+	LcdSpan *spans;     ///< One span per row, spans[0] is row @ref top.
+	uint16_t capacity;  ///< Number of rows the stencil covers.
+	int top;            ///< Screen row of spans[0].
+} LcdStencil;
+
+/**
+ * @brief Defines a stencil named @p name covering @p rows rows.
+ */
+#define LCD_STENCIL(name, rows) \
+	static LcdSpan name##Spans[rows]; \
+	static LcdStencil name = { name##Spans, (rows), 0 }
+
+/**
+ * @brief Read-only image of native RGB565 pixels stored row by row.
+ */
+typedef struct {
+	const uint16_t *pixels;  ///< Pointer to width * height pixels (usually placed in flash).
+	uint16_t width;          ///< Bitmap width in pixels.
+	uint16_t height;         ///< Bitmap height in pixels.
+	uint8_t useColorKey;     ///< Non-zero if pixels equal to colorKey are transparent.
+	uint16_t colorKey;       ///< Transparent color, used only if useColorKey is set.
+} LcdBitmap;
+
+/**
+ * @brief Registers another display.
+ * @details The display is not selected, select it to call lcdInitStart() and to draw.
+ * @param config Wiring of the display, copied.
+ * @param panel  Panel driver.
+ * @return Display handle, NULL if LCD_MAX_DISPLAYS displays already exist or the config is invalid.
+ */
+LcdDisplay* lcdAddDisplay(const LcdDisplayConfig *config, const LcdPanel *panel);
+
+/**
+ * @brief Makes all following lcd* calls operate on @p display.
+ * @return The previously selected display, to restore the selection.
+ */
+LcdDisplay* lcdSelectDisplay(LcdDisplay *display);
+
+/**
+ * @brief Returns the selected display.
+ */
+LcdDisplay* lcdGetDisplay();
+
+/**
+ * @brief Returns the on-board display.
+ */
+LcdDisplay* lcdGetDefaultDisplay();
+
+/**
+ * @brief Tells whether the framebuffer of the selected display is being read.
+ * @details Either a DMA transfer is in progress or an armed flush waits for
+ * the next tearing effect event to start one.
+ */
+uint8_t lcdIsBusy();
+
+/**
+ * @brief Selects the panel driver. Must be called before lcdInitStart(),
+ *        the ST7735S 160x128 panel is used by default.
+ * @param newPanel Panel description, e.g. &lcdPanelST7789.
+ */
+void lcdSetPanel(const LcdPanel *newPanel);
+
+/**
+ * @brief Enables the pipelined rendering.
+ * @details The framebuffer is split into two ping-pong band buffers: while
+ * the DMA sends one band, the next one is drawn into the other buffer, and
+ * the transfer complete interrupt swaps them. A frame then takes roughly
+ * max(render time, transfer time) instead of their sum. Frames are always
+ * rendered in bands in this mode (lcdIsBanded() returns 1), so partial
+ * updates of the framebuffer are not possible.
+ * @param enable 1 to enable, 0 to disable (default).
+ */
+void lcdSetPipelined(uint8_t enable);
+
+/**
+ * @brief Returns the active panel driver.
+ */
+const LcdPanel* lcdGetPanel();
+
+/**
+ * @brief Width of the active panel in pixels.
+ */
+int lcdGetWidth();
+
+/**
+ * @brief Height of the active panel in pixels.
+ */
+int lcdGetHeight();
+
+/**
+ * @brief Tells whether a full frame of the active panel does not fit in the framebuffer.
+ * @retval 1 if frames are rendered band by band, 0 if the whole frame is resident.
+ */
+uint8_t lcdIsBanded();
+
+/**
+ * @brief Starts rendering a frame. Use together with lcdNextBand():
+ * @code
+ * lcdBeginFrame();
+ * do {
+ *     // draw the whole scene, output is clipped to the resident band
+ * } while(lcdNextBand());
+ * @endcode
+ * With a full framebuffer the loop body runs once and lcdNextBand() is lcdCopy().
+ * A banded frame started while the display is not ready (bring-up, sleep)
+ * is dropped right away, check lcdIsFrameDropped() to skip drawing it.
+ */
+void lcdBeginFrame();
+
+/**
+ * @brief Flushes the current band and moves to the next one.
+ * @details A banded frame cannot be kept until the display is ready, it is
+ * dropped instead, see lcdIsFrameDropped().
+ * @retval 1 if another band has to be drawn, 0 when the frame is complete or dropped.
+ */
+uint8_t lcdNextBand();
+
+/**
+ * @brief Tells whether the last banded frame was dropped because the display
+ *        was not ready (bring-up in progress, sleeping).
+ * @details The scene has to be drawn again once lcdIsReady() returns 1.
+ * Cleared by lcdBeginFrame().
+ */
+uint8_t lcdIsFrameDropped();
+
+/**
+ * @brief Blocks until the running framebuffer transfer has finished.
+ *        Safe to call from interrupt handlers.
+ */
+void lcdWaitForTransfer();
 
 /**
  * @brief Transfers the framebuffer content to the display.
  *        Call this after drawing operations to refresh the screen.
+ *        If a transfer is already running, or the display is still being
+ *        initialized, the flush is deferred and performed as soon as possible.
  */
 void lcdCopy();
 
+/**
+ * @brief Transfers only a rectangle of the framebuffer to the display.
+ * @details Rectangles requested while a transfer is running are merged into
+ * their bounding box and sent together once the bus is free. A full
+ * lcdCopy() requested meanwhile covers them. Banded framebuffers always send
+ * the whole band.
+ * @param x      Top-left corner X coordinate
+ * @param y      Top-left corner Y coordinate
+ * @param width  Rectangle width in pixels
+ * @param height Rectangle height in pixels
+ */
+void lcdCopyRect(int x, int y, int width, int height);
+
+/**
+ * @brief Returns the first screen row not yet read by the running framebuffer transfer.
+ * @details Derived from the NDTR counter of the SPI DMA stream. While a TE
+ * synchronized frame is sent column by column no row is complete before the end.
+ * @return Row index, lcdGetHeight() when no framebuffer transfer is running.
+ */
+int lcdGetScanoutRow();
+
+/**
+ * @brief Enables the "race the beam" mode.
+ * @details Drawing into rows the running transfer has already read proceeds
+ * at once, drawing into rows it has yet to read waits until the DMA has
+ * passed them. Rendering of the next frame thus overlaps the transfer of
+ * the current one without a second framebuffer, and lcdCopy() of the new
+ * frame is deferred until the transfer completes. Without this mode nothing
+ * stops drawing from modifying rows before they are sent.
+ * @param enable 1 to enable, 0 to disable (default).
+ */
+void lcdSetRaceTheBeam(uint8_t enable);
+
 /**
  * @brief Sets a single pixel in the framebuffer.
- * @param x X coordinate (0–LCD_WIDTH-1)
- * @param y Y coordinate (0–LCD_HEIGHT-1)
+ * @param x X coordinate (0–lcdGetWidth()-1)
+ * @param y Y coordinate (0–lcdGetHeight()-1)
  * @param color 16-bit RGB565 color value
  */
 void lcdFillPixel(int x, int y, uint16_t color);
 
+/**
+ * @brief Restricts all subsequent drawing operations to a rectangle.
+ *        The rectangle is intersected with the screen area, pixels outside
+ *        of it are silently discarded.
+ * @param x      Top-left corner X coordinate
+ * @param y      Top-left corner Y coordinate
+ * @param width  Clip rectangle width in pixels
+ * @param height Clip rectangle height in pixels
+ */
+void lcdSetClipRect(int x, int y, int width, int height);
+
+/**
+ * @brief Restores the clip rectangle to the whole screen.
+ */
+void lcdResetClipRect();
+
+/**
+ * @brief Returns the currently active clip rectangle.
+ */
+const LcdRect* lcdGetClipRect();
+
+/**
+ * @brief Starts capturing a stencil. The following fill calls (lcdFillRoundRectangle(),
+ *        lcdFillCircle(), ...) add their pixels to the stencil instead of drawing them.
+ * @details Display list recording is suspended until lcdStencilEnd(), the
+ * stencil is built immediately. Rows outside the stencil are ignored.
+ * @param stencil Stencil to capture, its previous content is cleared.
+ * @param top     Screen row of the first stencil row.
+ *
+ * Example, content clipped to a rounded button:
+ * @code
+ *     LCD_STENCIL(buttonMask, 20);
+ *
+ *     lcdStencilBegin(&buttonMask, 40);
+ *     lcdFillRoundRectangle(10, 40, 80, 20, 6, 0);
+ *     lcdStencilEnd();
+ *
+ *     lcdSetStencil(&buttonMask);
+ *     lcdFillRectangle(10, 40, progress, 20, GREEN); // corners stay round
+ *     lcdSetStencil(NULL);
+ * @endcode
+ */
+void lcdStencilBegin(LcdStencil *stencil, int top);
+
+/**
+ * @brief Stops capturing, drawing calls are rasterized again.
+ */
+void lcdStencilEnd();
+
+/**
+ * @brief Restricts all subsequent drawing to the inside of a stencil, on top of the clip rectangle.
+ * @details The stencil is referenced, not copied, it must stay valid while
+ * it is set (and while display lists recording the call are replayed).
+ * @param stencil Captured stencil, NULL to draw without one.
+ */
+void lcdSetStencil(const LcdStencil *stencil);
+
 /**
  * @brief Initializes the LCD display and its controller.
- *        Must be called once before using any drawing functions.
+ *        Blocking variant, returns once the display is turned on.
+ *        Equivalent to lcdInitStart() followed by lcdProcess() until lcdIsReady().
  */
 void lcdInit();
 
 /**
- * @brief Fills the entire LCD screen with a single, specified color.
+ * @brief Starts the non-blocking display bring-up (reset pulse, init table,
+ *        sleep out, display on). Must be called once before using any drawing functions.
+ * @details Drawing into the framebuffer is allowed immediately. A frame
+ * flushed with lcdCopy() before the controller is ready is kept pending and
+ * written to the panel before the display is turned on, so the first visible
+ * image is already the application's frame.
+ */
+void lcdInitStart();
+
+/**
+ * @brief Advances the bring-up and sleep state machines of every display.
+ *        Call periodically (main loop or a timer tick).
+ */
+void lcdProcess();
+
+/**
+ * @brief Tells whether the bring-up has finished and the display is on.
+ * @retval 1 if the display is ready, 0 otherwise.
+ */
+uint8_t lcdIsReady();
+
+/**
+ * @brief Time from MCU reset to the first frame being visible on the panel.
+ * @return Time in milliseconds, or 0 if the first frame was not shown yet.
+ */
+uint32_t lcdGetTimeToFirstFrameMs();
+
+/**
+ * @brief Must be called from HAL_SPI_TxCpltCallback().
+ *        Releases the bus of the display on @p hspi and starts a flush
+ *        requested while the DMA was busy. Other SPI handles are ignored.
+ */
+void lcdTransferCompleteCallback(SPI_HandleTypeDef *hspi);
+
+/**
+ * @brief Selects when flushes are sent to the panel.
+ * @details In LCD_PRESENT_TE_SYNC mode the controller TE output is enabled
+ * and lcdCopy() only arms the flush, the transfer is started by the next
+ * tearing effect event. The controller is also switched to write its RAM
+ * in the order of the gate scan, so a transfer started at the beginning of
+ * the vertical blanking stays behind the scan and never crosses it as long
+ * as it takes less than two refresh periods (a full 160x128 frame takes
+ * about 15 ms at 22.5 MHz, the ST7735S refreshes every 12.4 ms).
+ * In banded mode only the first band is synchronized.
+ * May be called at any time, also before lcdInitStart().
+ * @param mode New present mode.
+ */
+void lcdSetPresentMode(LcdPresentMode mode);
+
+/**
+ * @brief Returns the active present mode.
+ */
+LcdPresentMode lcdGetPresentMode();
+
+/**
+ * @brief Selects where the tearing effect events come from.
+ * @details Tells the driver the board delivers the events, see
+ * lcdCopyRectAndScroll(). Whatever the source, an armed flush whose event
+ * does not come within 50 ms is sent unsynchronized.
+ * @param source   LCD_TE_SOURCE_PIN (default) or LCD_TE_SOURCE_SOFTWARE.
+ * @param periodMs Period of the software events, ignored for the pin source.
+ */
+void lcdSetTearingEffectSource(LcdTeSource source, uint32_t periodMs);
+
+/**
+ * @brief Must be called from HAL_GPIO_EXTI_Callback().
+ *        Starts the armed flush of the display whose TE output is on @p pin.
+ */
+void lcdTearingEffectCallback(uint16_t pin);
+
+/**
+ * @brief Switches idle mode on or off.
+ * @details In idle mode the panel shows 8 colors only (the most significant
+ * bit of every color component) and the controller draws less current,
+ * meant for static screens. The framebuffer is not affected.
+ * May be called at any time, also before lcdInitStart().
+ * @param enable 1 to enter idle mode, 0 to return to full colors.
+ */
+void lcdSetIdleMode(uint8_t enable);
+
+/**
+ * @brief Refreshes only a band of scan lines, the rest of the glass is blanked.
+ * @details Scan lines are the gate lines of the panel: screen rows for
+ * portrait panels and screen columns for panels whose MADCTL exchanges rows
+ * and columns (the landscape ST7735S and ILI9341). The controller RAM is
+ * still fully writable. May be called at any time, also before lcdInitStart().
+ * @param first First scan line of the visible band.
+ * @param count Number of scan lines, 0 to return to normal mode.
+ */
+void lcdSetPartialMode(int first, int count);
+
+/**
+ * @brief Tells along which screen axis lcdSetScrollOffset() moves the picture.
+ */
+LcdScrollAxis lcdGetScrollAxis();
+
+/**
+ * @brief Rotates the picture along the scan lines without sending pixels.
+ * @details Scan line n of the glass shows the controller RAM line
+ * (n + offset) modulo the number of scan lines, the lines scrolled out on
+ * one side come back on the other. Only the displayed picture moves: RAM
+ * writes (lcdCopy(), lcdCopyRect()) still address the unscrolled lines, so
+ * a rectangle written at scan line n appears at n - offset. Offset 0 is the
+ * normal display. Waits for the running transfer, may be called at any
+ * time, the offset is restored after a bring-up.
+ * @param offset Scan lines, see lcdGetScrollAxis().
+ * @retval 1 if the panel scrolls, 0 if it has no scroll registers (scanLines is 0).
+ */
+uint8_t lcdSetScrollOffset(int offset);
+
+/**
+ * @brief Sends a rectangle and moves the scroll start line in the same vertical blanking.
+ * @details For a strip brought onto the glass by the new offset: its RAM
+ * lines are still shown at the opposite edge until the start line moves,
+ * so the pixels must not land while the panel scans the old offset, nor
+ * the offset move before the pixels. The transfer is started by the next
+ * tearing effect event and the offset is sent right after it from the
+ * transfer complete interrupt, both within the blanking as long as the
+ * rectangle takes less than the porches (about 4 ms on the ST7735S with
+ * its init table, a 20 scan line strip takes 2 ms at 21 Mbit/s). Only in
+ * LCD_PRESENT_TE_SYNC or after lcdSetTearingEffectSource(), otherwise the
+ * TE line may not be wired and the rectangle and offset are sent right away
+ * like lcdCopyRect() and lcdSetScrollOffset(). Outside LCD_PRESENT_TE_SYNC
+ * the TE output is turned on until the offset is 0 again. Returns without
+ * waiting, a following call waits for the previous step. Flushes requested
+ * meanwhile go out with the strip.
+ * @param offset Scan lines, see lcdSetScrollOffset().
+ * @retval 1 if the panel scrolls, 0 if it has no scroll registers (scanLines is 0).
+ */
+uint8_t lcdCopyRectAndScroll(int x, int y, int width, int height, int offset);
+
+/**
+ * @brief Reprograms the panel refresh rate.
+ * @details A lower rate saves power on static screens. The rate is kept for
+ * the next bring-up. Adjust the software TE period (lcdSetTearingEffectSource())
+ * when it is used.
+ * @param hz Requested rate, 0 keeps the init table setting from the next bring-up on.
+ * @return Rate set in Hz (the closest one the controller supports), 0 if the
+ *         display is not initialized yet or the panel has no rate control.
+ */
+uint8_t lcdSetFrameRate(uint8_t hz);
+
+/**
+ * @brief Puts the panel to sleep, its registers and RAM content are retained.
+ * @details Waits for the running transfer. Until lcdWake() completes
+ * lcdIsReady() returns 0 and flushes are deferred, the last one is sent
+ * on wake up. Banded frames cannot be deferred, they are dropped and have
+ * to be drawn again after the wake up, see lcdIsFrameDropped(). Does
+ * nothing unless the display is ready.
+ */
+void lcdSleep();
+
+/**
+ * @brief Leaves sleep mode without a new bring-up.
+ * @details Returns immediately, lcdProcess() sends SLPOUT and waits for the
+ * controller to settle, lcdIsReady() returns 1 afterwards.
+ */
+void lcdWake();
+
+/**
+ * @brief Tells whether the panel sleeps or is entering or leaving sleep mode.
+ */
+uint8_t lcdIsSleeping();
+
+/**
+ * @brief Fills the entire LCD screen (within the clip rectangle) with a single, specified color.
  * @param color 16-bit RGB565 color value to fill the background with.
  */
 void lcdFillBackground(uint16_t color);
@@ -0,0 +1,62 @@
+/*
+ * lcd_blit.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Framebuffer to framebuffer copies. Scrolling content is shifted with
+ *  lcdMoveRegion() and only the newly exposed strip has to be drawn.
+ *  lcdReadRegion() and lcdDrawBitmap() save and restore rendered areas
+ *  through off-screen RGB565 surfaces.
+ */
+
+#pragma once
+
+#include "lcd.h"
+#include "perf.h"
+
+/**
+ * @brief Statistics of lcdMoveRegion(), items are moved pixels.
+ */
+extern Perf_Counter lcdMoveRegionPerf;
+
+/**
+ * @brief Statistics of lcdDrawBitmap() and lcdReadRegion(), items are copied pixels.
+ */
+extern Perf_Counter lcdBlitPerf;
+
+/**
+ * @brief Moves a rectangle of framebuffer pixels by (dx, dy).
+ * @details Source and destination may overlap, rows and pixels are copied
+ * in the order that never overwrites pixels not yet read. Both are limited
+ * to the active clip rectangle, in banded mode this means the current band,
+ * and only destination pixels inside the active stencil are written.
+ * The pixels uncovered at the source keep their old content, the caller
+ * draws the exposed strip. Nothing is sent to the panel.
+ * @param src Rectangle to move.
+ * @param dx  Horizontal shift in pixels, negative to the left.
+ * @param dy  Vertical shift in pixels, negative upwards.
+ */
+void lcdMoveRegion(const LcdRect *src, int dx, int dy);
+
+/**
+ * @brief Copies a bitmap into the framebuffer, row by row.
+ * @details Limited to the active clip rectangle and stencil. Opaque bitmaps
+ * are copied with word moves, pixels equal to the color key of a keyed
+ * bitmap are skipped. Display lists record the bitmap pointer, the pixels
+ * must stay unchanged while the list is replayed.
+ * @param bitmap Image to draw.
+ * @param x      Destination top-left corner X coordinate
+ * @param y      Destination top-left corner Y coordinate
+ */
+void lcdDrawBitmap(const LcdBitmap *bitmap, int x, int y);
+
+/**
+ * @brief Copies a rectangle of the framebuffer into off-screen memory.
+ * @details Only the part inside the active clip rectangle is read, in banded
+ * mode this means the current band, the other pixels of @p pixels are left
+ * untouched. Must not be called while a display list is recorded.
+ * @param src    Rectangle to read.
+ * @param pixels Destination, src->width * src->height pixels row by row.
+ */
+void lcdReadRegion(const LcdRect *src, uint16_t *pixels);
@@ -0,0 +1,119 @@
+/*
+ * lcd_dlist.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Display lists. While a list is being recorded the lcd* drawing calls
+ *  are not rasterized, they are appended to the list as an opcode followed
+ *  by 16-bit parameters. Strings placed in flash are referenced by pointer,
+ *  strings in RAM are copied into the list so later changes of the buffer
+ *  do not alter the recorded frame. A list can be replayed any number of
+ *  times into the framebuffer, a band or a dirty region, and its hash
+ *  allows skipping frames identical to the one on the screen.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "lcd.h"
+
+/**
+ * @brief Commands stored in a display list.
+ */
+typedef enum {
+	LCD_OP_FILL_BACKGROUND,       /**< color */
+	LCD_OP_FILL_PIXEL,            /**< x, y, color */
+	LCD_OP_DRAW_LINE,             /**< x0, y0, x1, y1, color */
+	LCD_OP_DRAW_RECTANGLE,        /**< x, y, width, height, color */
+	LCD_OP_FILL_RECTANGLE,        /**< x, y, width, height, color */
+	LCD_OP_DRAW_CIRCLE,           /**< x, y, radius, color */
+	LCD_OP_FILL_CIRCLE,           /**< x, y, radius, color */
+	LCD_OP_DRAW_ROUND_RECTANGLE,  /**< x, y, width, height, radius, color */
+	LCD_OP_FILL_ROUND_RECTANGLE,  /**< x, y, width, height, radius, color */
+	LCD_OP_DRAW_TEXT,             /**< x, y, color, bgColor, string pointer (2 words) */
+	LCD_OP_DRAW_TEXT_INLINE,      /**< x, y, color, bgColor, characters packed 2 per word */
+	LCD_OP_SET_CLIP,              /**< x, y, width, height */
+	LCD_OP_DRAW_BITMAP_ROTOZOOM,  /**< bitmap pointer (2 words), x, y, width, height, angle, scale (2 words), filter */
+	LCD_OP_MOVE_REGION,           /**< x, y, width, height, dx, dy */
+	LCD_OP_SET_STENCIL,           /**< stencil pointer (2 words), NULL to clear */
+	LCD_OP_FILL_LINEAR_GRADIENT,  /**< x, y, width, height, direction, dither, from, to */
+	LCD_OP_FILL_RADIAL_GRADIENT,  /**< x, y, width, height, cx, cy, radius, dither, inner, outer */
+	LCD_OP_DRAW_SHADOW,           /**< shadow pointer (2 words), x, y, width, height, color */
+	LCD_OP_DRAW_BITMAP,           /**< bitmap pointer (2 words), x, y */
+	LCD_OP_DRAW_RLE_IMAGE,        /**< image pointer (2 words), x, y */
+	LCD_OP_COUNT
+} LcdOpcode;
+
+/**
+ * @brief Recorded sequence of drawing commands.
+ * @details Every command starts with a header word holding the opcode in
+ * the low byte and the command length in words (header included) in the
+ * high byte. Use LCD_DISPLAY_LIST() to define a list with its storage.
+ */
+typedef struct {
+	uint16_t *words;     ///< Command storage.
+	uint16_t capacity;   ///< Size of the storage in words.
+	uint16_t length;     ///< Number of recorded words.
+	uint32_t hash;       ///< FNV-1a hash of the recorded words.
+	uint8_t overflow;    ///< Set if a command did not fit, the list must not be replayed.
+} LcdDisplayList;
+
+/**
+ * @brief Defines a display list named @p name with storage for @p capacity words.
+ */
+#define LCD_DISPLAY_LIST(name, capacity) \
+	static uint16_t name##Words[capacity]; \
+	static LcdDisplayList name = { name##Words, (capacity), 0, 0, 0 }
+
+/**
+ * @brief Clears the list and redirects all following lcd* drawing calls into it.
+ * @param list List to record into.
+ */
+void lcdDisplayListBegin(LcdDisplayList *list);
+
+/**
+ * @brief Stops recording, drawing calls are rasterized again.
+ * @retval 1 if the whole frame was recorded, 0 if the list overflowed.
+ */
+uint8_t lcdDisplayListEnd();
+
+/**
+ * @brief Executes the commands of a list.
+ * @details Output goes to the framebuffer rows currently resident (the whole
+ * frame or the current band). The clip rectangle and the stencil are reset
+ * when done.
+ * @param list   Recorded list.
+ * @param region Area to redraw, every command (including recorded clip
+ *               rectangles) is limited to it. NULL for the whole screen.
+ */
+void lcdDisplayListReplay(const LcdDisplayList *list, const LcdRect *region);
+
+/**
+ * @brief Rasterizes and flushes a list as a full frame, band by band if needed.
+ * @details Nothing is drawn nor sent when the list is identical to the last
+ * one presented on the selected display.
+ * @param list Recorded list.
+ * @retval 1 if the frame was drawn, 0 if it was skipped (or the list overflowed).
+ */
+uint8_t lcdDisplayListPresent(const LcdDisplayList *list);
+
+/**
+ * @brief Forgets the last list presented on the selected display.
+ *        Must be called after drawing to the screen without lcdDisplayListPresent().
+ */
+void lcdDisplayListInvalidate();
+
+/**
+ * @brief Statistics of lcdDisplayListPresent(), items are 1 for a drawn frame and 0 for a skipped one.
+ */
+extern Perf_Counter lcdDisplayListPerf;
+
+/**
+ * @brief Prints a list as text, one command per line, e.g. "FILL_RECTANGLE 10 20 30 12 0xf800".
+ * @details Dumps of two frames taken over a serial port can be compared with
+ * any text diff tool to see which commands changed.
+ * @param list  Recorded list.
+ * @param write Called for every line (without line terminator).
+ */
+void lcdDisplayListDump(const LcdDisplayList *list, void (*write)(const char *line));
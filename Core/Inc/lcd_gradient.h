@@ -0,0 +1,119 @@
+/*
+ * lcd_gradient.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Gradient fills and soft drop shadows for the LCD framebuffer.
+ *  Colors are stepped per span in 16.16 fixed point, an optional 4x4
+ *  ordered (Bayer) dither hides the banding of the 5/6 bit RGB565
+ *  channels. Shadows blend a precomputed corner mask, the per pixel work
+ *  is a table lookup and one packed RGB565 blend.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "lcd.h"
+#include "perf.h"
+
+/**
+ * @brief Axis along which a linear gradient changes.
+ */
+typedef enum {
+	LCD_GRADIENT_HORIZONTAL,  /**< From the left edge to the right edge. */
+	LCD_GRADIENT_VERTICAL,    /**< From the top edge to the bottom edge. */
+} LcdGradientDirection;
+
+/**
+ * @brief Fill operations measured by lcdGradientPerf.
+ */
+typedef enum {
+	LCD_FILL_SOLID,   /**< lcdFillRectangle(), recorded by lcdGradientBenchmark() only. */
+	LCD_FILL_LINEAR,  /**< lcdFillLinearGradient() */
+	LCD_FILL_RADIAL,  /**< lcdFillRadialGradient() */
+	LCD_FILL_SHADOW,  /**< lcdDrawShadow() */
+	LCD_FILL_KIND_COUNT
+} LcdFillKind;
+
+/**
+ * @brief Throughput of the fills, one counter per kind. Items are written pixels.
+ */
+extern Perf_Counter lcdGradientPerf[LCD_FILL_KIND_COUNT];
+
+/**
+ * @brief Soft shadow of a rounded rectangle with a fixed corner radius and blur.
+ * @details Holds the alpha of one corner quadrant, (radius + blur) pixels
+ * square, mirrored for the other corners and stretched along the edges.
+ * The mask is computed on the first lcdDrawShadow() call. Use LCD_SHADOW()
+ * to define a shadow with its storage.
+ */
+typedef struct {
+	uint8_t *alpha;    ///< Corner mask, 0 (transparent) to 32 (opaque), row by row.
+	uint8_t radius;    ///< Corner radius of the rectangle casting the shadow.
+	uint8_t blur;      ///< Width of the soft edge in pixels.
+	uint8_t opacity;   ///< Opacity of the shadow under the rectangle, 0 to 255.
+	uint8_t ready;     ///< Non-zero once the mask has been computed.
+} LcdShadow;
+
+/**
+ * @brief Defines a shadow named @p name for rectangles with the given corner radius.
+ */
+#define LCD_SHADOW(name, radius, blur, opacity) \
+	static uint8_t name##Alpha[((radius) + (blur)) * ((radius) + (blur))]; \
+	static LcdShadow name = { name##Alpha, (radius), (blur), (opacity), 0 }
+
+/**
+ * @brief Fills a rectangle with a linear gradient.
+ * @param x         Top-left corner X coordinate
+ * @param y         Top-left corner Y coordinate
+ * @param width     Rectangle width in pixels
+ * @param height    Rectangle height in pixels
+ * @param from      Color of the first row or column
+ * @param to        Color of the last row or column
+ * @param direction Axis of the color change
+ * @param dither    Non-zero to apply 4x4 ordered dithering
+ */
+void lcdFillLinearGradient(int x, int y, int width, int height, uint16_t from, uint16_t to,
+						   LcdGradientDirection direction, uint8_t dither);
+
+/**
+ * @brief Fills a rectangle with a radial gradient.
+ * @details Distances are tracked incrementally in quarter pixels, no square
+ * root is taken per pixel. Pixels farther than @p radius get @p outer.
+ * @param x       Top-left corner X coordinate
+ * @param y       Top-left corner Y coordinate
+ * @param width   Rectangle width in pixels
+ * @param height  Rectangle height in pixels
+ * @param cx      Gradient center X coordinate
+ * @param cy      Gradient center Y coordinate
+ * @param radius  Distance at which @p outer is reached, must be positive
+ * @param inner   Color at the center
+ * @param outer   Color at and beyond @p radius
+ * @param dither  Non-zero to apply 4x4 ordered dithering
+ */
+void lcdFillRadialGradient(int x, int y, int width, int height, int cx, int cy, int radius,
+						   uint16_t inner, uint16_t outer, uint8_t dither);
+
+/**
+ * @brief Blends the shadow of a rounded rectangle into the framebuffer.
+ * @details The shadow covers the rectangle grown by the blur width on
+ * every side. Draw it before the rectangle itself, usually offset by a few
+ * pixels down and right.
+ * @param shadow Shadow defined with LCD_SHADOW(), its radius should match the rectangle.
+ * @param x      Rectangle top-left corner X coordinate
+ * @param y      Rectangle top-left corner Y coordinate
+ * @param width  Rectangle width in pixels
+ * @param height Rectangle height in pixels
+ * @param color  Shadow color
+ */
+void lcdDrawShadow(LcdShadow *shadow, int x, int y, int width, int height, uint16_t color);
+
+/**
+ * @brief Measures the gradient fills against lcdFillRectangle() on the whole clip rectangle.
+ * @details Resets lcdGradientPerf and fills the clip rectangle @p iterations
+ * times with every kind, compare the counters with Perf_ItemsPerSecond().
+ * The framebuffer content is destroyed, redraw the screen afterwards.
+ * Must not be called while a display list is recorded.
+ */
+void lcdGradientBenchmark(int iterations);
@@ -0,0 +1,127 @@
+/*
+ * lcd_internal.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Private interface shared between the LCD driver translation units.
+ *  Not meant to be included by the UI or application layers.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "lcd.h"
+#include "lcd_dlist.h"
+#include "stm32f4xx_hal.h"
+
+/** @brief Marks an init table entry as a command byte (DC low). */
+#define CMD(x) ((x) | 0x100)
+
+// MIPI DCS commands shared by all supported controllers
+#define LCD_CMD_SLPIN			0x10
+#define LCD_CMD_SLPOUT			0x11
+#define LCD_CMD_PTLON			0x12
+#define LCD_CMD_NORON			0x13
+#define LCD_CMD_INVON			0x21
+#define LCD_CMD_DISPOFF			0x28
+#define LCD_CMD_DISPON			0x29
+#define LCD_CMD_CASET			0x2a
+#define LCD_CMD_RASET			0x2b
+#define LCD_CMD_RAMWR			0x2c
+#define LCD_CMD_PTLAR			0x30
+#define LCD_CMD_VSCRDEF			0x33
+#define LCD_CMD_TEOFF			0x34
+#define LCD_CMD_TEON			0x35
+#define LCD_CMD_MADCTL			0x36
+#define LCD_CMD_VSCSAD			0x37
+#define LCD_CMD_IDMOFF			0x38
+#define LCD_CMD_IDMON			0x39
+#define LCD_CMD_COLMOD			0x3a
+
+/** @brief MADCTL row address order bit, mirrors the gate scan. */
+#define LCD_MADCTL_MY			0x80
+/** @brief MADCTL row/column exchange bit. */
+#define LCD_MADCTL_MV			0x20
+
+/**
+ * @brief Position of the selected display in the display pool, 0 for the on-board one.
+ *        Indexes per-display state kept outside lcd.c.
+ */
+uint8_t lcdGetDisplayIndex();
+
+/**
+ * @brief SPI bus of the selected display.
+ */
+SPI_HandleTypeDef* lcdGetSpi();
+
+/**
+ * @brief Marks the bus of the selected display busy until lcdTransferCompleteCallback().
+ */
+void lcdSetSpiBusy();
+
+/**
+ * @brief Sends a single command byte (DC low), blocking.
+ */
+void lcdCmd(uint8_t cmd);
+
+/**
+ * @brief Sends a single parameter byte (DC high), blocking.
+ */
+void lcdData(uint8_t data);
+
+/**
+ * @brief Sends a 16-bit parameter, most significant byte first.
+ */
+void lcdData16(uint16_t value);
+
+/**
+ * @brief Sends an init table entry, either a CMD() marked command or a parameter.
+ */
+void lcdSend(uint16_t value);
+
+/**
+ * @brief Selects a window, issues RAMWR and leaves CS low with DC high,
+ *        ready for the pixel data transfer.
+ * @details The bus is left in 16-bit frame mode, DMA lengths are counted in
+ * pixels. The next lcdCmd() or lcdData() switches it back to 8-bit frames.
+ */
+void lcdBeginRamWrite(int x, int y, int width, int height);
+
+/**
+ * @brief Returns a pointer to the first pixel of a framebuffer row.
+ * @details In banded mode only the rows of the current band are resident,
+ * valid rows are the ones inside lcdGetClipRect().
+ * @param y Screen row index, no bounds checking is done.
+ */
+uint16_t* lcdFrameBufferRow(int y);
+
+/**
+ * @brief Narrows the columns [*x0, *x1) of row @p y to the active stencil.
+ * @details For code writing framebuffer rows directly, lcdFillPixel()
+ * applies the stencil on its own.
+ * @retval 0 if no pixel of the range is inside the stencil.
+ */
+uint8_t lcdStencilClipRow(int y, int *x0, int *x1);
+
+/**
+ * @brief Returns the whole framebuffer for reading, rows of lcdGetWidth() pixels.
+ * @details Unlike lcdFrameBufferRow() it never waits for the scanout.
+ * @return NULL in banded mode, where only a part of the frame is resident.
+ */
+const uint16_t* lcdGetFrameBuffer();
+
+/**
+ * @brief Display list the drawing calls are recorded into, NULL when they are rasterized.
+ */
+extern LcdDisplayList *lcdRecordTarget;
+
+/**
+ * @brief Appends a command with @p count 16-bit parameters (passed as int) to lcdRecordTarget.
+ */
+void lcdRecord(LcdOpcode op, int count, ...);
+
+/**
+ * @brief Appends a text command to lcdRecordTarget, RAM strings are copied into the list.
+ */
+void lcdRecordText(int x, int y, const char *str, uint16_t color, uint16_t bgColor);
@@ -0,0 +1,83 @@
+/*
+ * lcd_mirror.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Screenshots and live mirroring of the framebuffer over the ST-Link
+ *  virtual COM port (USART2). Text commands are received line by line:
+ *
+ *    SHOT          send the whole frame once
+ *    MIRROR <ms>   send the changed areas every <ms> milliseconds
+ *    MIRROR 0      stop mirroring
+ *
+ *  Every frame is a header followed by rectangles of RLE packed pixels,
+ *  all integers little endian:
+ *
+ *    "LCDM", type (0 full, 1 delta), sequence, width (2), height (2), rect count (2)
+ *    per rectangle: x (2), y (2), width (2), height (2), packets
+ *
+ *  The packets are those of lcd_rle.h: a header n < 128 is followed by
+ *  n + 1 literal pixels, n >= 128 by one pixel repeated n - 126 times.
+ *  Pixels are RGB565, most significant byte first (the byte order of the
+ *  panel), and runs continue across the rows of a rectangle. The frames are decoded by Tools/lcd_mirror_viewer.py.
+ *
+ *  Changes are detected on 16x16 tiles by comparing a hash of every tile
+ *  with the one taken when it was last sent, no copy of the frame is kept.
+ *  Only full (non banded) framebuffers can be mirrored.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "perf.h"
+#include "usart.h"
+
+/** @brief Size of each of the two transmit buffers in bytes. */
+#define LCD_MIRROR_TX_BYTES		512
+
+/** @brief Side of the tiles changes are detected on, in pixels. */
+#define LCD_MIRROR_TILE			16
+
+/**
+ * @brief Statistics of the sent frames, from the start of the encoding to the
+ *        last byte handed to the DMA. Items are bytes.
+ */
+extern Perf_Counter lcdMirrorPerf;
+
+/**
+ * @brief Starts listening for commands on USART2.
+ */
+void lcdMirrorStart();
+
+/**
+ * @brief Requests a full frame, sent by the next lcdMirrorProcess() calls.
+ */
+void lcdMirrorScreenshot();
+
+/**
+ * @brief Enables or disables live mirroring.
+ * @param periodMs Minimum time between the starts of two frames, 0 to stop.
+ */
+void lcdMirrorSetPeriod(uint32_t periodMs);
+
+/**
+ * @brief Encodes the pending frame into the idle transmit buffer.
+ * @details Call from the main loop. Returns as soon as both transmit
+ * buffers are in use, the encoding continues on the next call, so a slow
+ * serial link never blocks the caller. Drawing interrupts may preempt it
+ * at any time.
+ */
+void lcdMirrorProcess();
+
+/**
+ * @brief Must be called from HAL_UART_RxCpltCallback().
+ *        Collects command lines, other UART handles are ignored.
+ */
+void lcdMirrorReceiveCallback(UART_HandleTypeDef *huart);
+
+/**
+ * @brief Must be called from HAL_UART_TxCpltCallback().
+ *        Starts the queued transmit buffer, other UART handles are ignored.
+ */
+void lcdMirrorTransmitCompleteCallback(UART_HandleTypeDef *huart);
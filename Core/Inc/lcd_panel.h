@@ -0,0 +1,70 @@
+/*
+ * lcd_panel.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Panel driver interface. Everything that differs between display
+ *  controllers (init sequence, addressing window, pixel format and
+ *  dimensions) is described by an LcdPanel, the drawing layer in lcd.c
+ *  only works with the runtime dimensions taken from it.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Description and operations of a display controller + glass combination.
+ */
+typedef struct LcdPanel {
+	const char *name;        ///< Human readable panel name.
+	uint16_t width;          ///< Visible width in pixels in the configured orientation.
+	uint16_t height;         ///< Visible height in pixels in the configured orientation.
+	uint16_t offsetX;        ///< Column offset of the glass inside the controller RAM.
+	uint16_t offsetY;        ///< Row offset of the glass inside the controller RAM.
+	uint8_t bytesPerPixel;   ///< Size of one pixel on the wire (2 for RGB565).
+	uint8_t madctl;          ///< MADCTL value of the configured orientation, sent after the init sequence.
+	uint16_t scanLines;      ///< Gate lines of the controller RAM, the range of VSCRDEF. 0 if the panel cannot scroll.
+
+	const uint16_t *initTable;   ///< Init commands, commands are marked with CMD().
+	size_t initTableLength;      ///< Number of entries in initTable.
+
+	/**
+	 * @brief Sends the controller configuration (after reset and sleep out).
+	 */
+	void (*sendInitSequence)(const struct LcdPanel *panel);
+
+	/**
+	 * @brief Selects the controller RAM area written by the next RAMWR.
+	 */
+	void (*setWindow)(const struct LcdPanel *panel, int x, int y, int width, int height);
+
+	/**
+	 * @brief Reprograms the refresh rate to the supported value closest to @p hz.
+	 *        NULL if the controller has no frame rate control.
+	 * @return The frame rate set in Hz.
+	 */
+	uint8_t (*setFrameRate)(const struct LcdPanel *panel, uint8_t hz);
+} LcdPanel;
+
+/** @brief 1.8" 160x128 ST7735S panel, landscape. Default panel. */
+extern const LcdPanel lcdPanelST7735S;
+
+/** @brief 1.3"/1.54" 240x240 ST7789 panel. */
+extern const LcdPanel lcdPanelST7789;
+
+/** @brief 2.4"/2.8" 320x240 ILI9341 panel, landscape. */
+extern const LcdPanel lcdPanelILI9341;
+
+/**
+ * @brief Sends panel->initTable entry by entry. Default sendInitSequence operation.
+ */
+void lcdPanelSendInitTable(const struct LcdPanel *panel);
+
+/**
+ * @brief Sets the window with the standard MIPI DCS CASET/RASET commands,
+ *        including the panel offsets. Default setWindow operation.
+ */
+void lcdPanelSetWindowDcs(const struct LcdPanel *panel, int x, int y, int width, int height);
@@ -0,0 +1,69 @@
+/*
+ * lcd_rle.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Run length coded RGB565 images, the packet format of lcd_mirror.h:
+ *  a header n < 128 is followed by n + 1 literal pixels, n >= 128 by one
+ *  pixel repeated n - 126 times. Pixels are most significant byte first and
+ *  runs continue across rows. Flat UI screens shrink to a few kilobytes and
+ *  decode with one fill per run.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "lcd.h"
+#include "perf.h"
+
+#define LCD_RLE_MAX_LITERAL         128
+#define LCD_RLE_MAX_REPEAT          129
+#define LCD_RLE_MAX_PACKET_BYTES    (1 + LCD_RLE_MAX_LITERAL * 2)
+
+/**
+ * @brief Run length coded image.
+ */
+typedef struct {
+	const uint8_t *data;  ///< Packets, row by row.
+	uint32_t size;        ///< Length of data in bytes.
+	uint16_t width;       ///< Image width in pixels.
+	uint16_t height;      ///< Image height in pixels.
+} LcdRleImage;
+
+/**
+ * @brief Statistics of lcdDrawRleImage(), items are decoded pixels.
+ */
+extern Perf_Counter lcdRleDecodePerf;
+
+/**
+ * @brief Packs pixels of a rectangle into one packet.
+ * @param pixels Image the rectangle is taken from.
+ * @param stride Width of @p pixels in pixels.
+ * @param rect   Rectangle being encoded.
+ * @param index  Next pixel of the rectangle (row by row), advanced past the packed ones.
+ * @param out    Output, room for LCD_RLE_MAX_PACKET_BYTES.
+ * @return Number of bytes written to @p out.
+ */
+uint16_t lcdRleEncodePacket(const uint16_t *pixels, int stride, const LcdRect *rect, uint32_t *index, uint8_t *out);
+
+/**
+ * @brief Encodes a rectangle of the framebuffer.
+ * @details Only full (non banded) framebuffers can be encoded.
+ * @param rect     Rectangle to encode, must lie inside the screen.
+ * @param out      Output buffer.
+ * @param capacity Size of @p out in bytes.
+ * @return Length of the encoded data, 0 if it does not fit or the framebuffer is banded.
+ */
+uint32_t lcdRleEncode(const LcdRect *rect, uint8_t *out, uint32_t capacity);
+
+/**
+ * @brief Decodes an image into the framebuffer.
+ * @details Limited to the active clip rectangle and stencil, rows below the
+ * clip rectangle are not decoded. Display lists record the image pointer,
+ * the image must stay unchanged while the list is replayed.
+ * @param image Image to draw.
+ * @param x     Destination top-left corner X coordinate
+ * @param y     Destination top-left corner Y coordinate
+ */
+void lcdDrawRleImage(const LcdRleImage *image, int x, int y);
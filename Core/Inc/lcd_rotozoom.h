@@ -0,0 +1,53 @@
+/*
+ * lcd_rotozoom.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Rotated and scaled bitmap blitter working on the LCD framebuffer.
+ *  Texture coordinates are stepped incrementally in 16.16 fixed point,
+ *  so no divisions or floating point are used per pixel.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "lcd.h"
+#include "perf.h"
+
+/** @brief Scale factor of 1.0 in 16.16 fixed point. */
+#define LCD_SCALE_ONE	0x10000
+
+/**
+ * @brief Texture sampling mode used by the rotozoom blitter.
+ */
+typedef enum {
+	LCD_FILTER_NEAREST,   /**< Nearest texel, fastest, blocky when zoomed in. */
+	LCD_FILTER_BILINEAR,  /**< Weighted average of the four closest texels. */
+	LCD_FILTER_COUNT
+} LcdFilter;
+
+/**
+ * @brief Throughput statistics of the blitter, one counter per filter mode.
+ * @details Items are destination pixels, so Perf_ItemsPerSecond() reports
+ * the achieved fill rate of each mode.
+ */
+extern Perf_Counter lcdRotozoomPerf[LCD_FILTER_COUNT];
+
+/**
+ * @brief Draws a bitmap rotated around its center and scaled, centered in a destination rectangle.
+ * @details Output is limited to the destination rectangle and the active clip rectangle.
+ * Transparent pixels (color key) are skipped, in bilinear mode the key is tested
+ * on the nearest texel.
+ * @param bitmap    Source image.
+ * @param dstX      Destination rectangle top-left X coordinate
+ * @param dstY      Destination rectangle top-left Y coordinate
+ * @param dstWidth  Destination rectangle width in pixels
+ * @param dstHeight Destination rectangle height in pixels
+ * @param angleDeg  Clockwise rotation in degrees, any value (normalized internally)
+ * @param scale     Zoom factor in 16.16 fixed point (LCD_SCALE_ONE = 1:1), must be positive
+ * @param filter    Sampling mode
+ */
+void lcdDrawBitmapRotozoom(const LcdBitmap *bitmap,
+						   int dstX, int dstY, int dstWidth, int dstHeight,
+						   int angleDeg, int32_t scale, LcdFilter filter);
@@ -0,0 +1,85 @@
+/*
+ * lcd_stream.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Streaming pixel transfers of arbitrary length. The bulk of a stream is
+ *  sent with the DMA stream in double-buffer mode: while one memory buffer
+ *  is read by the DMA, the CPU refills (or expands data into) the other one.
+ *  This lifts the 65535 pixels limit of a single HAL_SPI_Transmit_DMA().
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "perf.h"
+
+/** @brief Size of one half of the double buffer in bytes. */
+#define LCD_STREAM_CHUNK_BYTES	1024
+
+/**
+ * @brief Produces the next piece of a pixel stream.
+ * @details Called from the DMA interrupt while the other half of the double
+ * buffer is being sent, so it must be fast and must not draw or transfer.
+ * @param context User pointer passed to lcdStreamWindow().
+ * @param scratch Idle buffer of LCD_STREAM_CHUNK_BYTES bytes that may be used to build the data.
+ * @param offset  Byte offset of the requested piece within the stream.
+ * @param length  Number of requested bytes (at most LCD_STREAM_CHUNK_BYTES).
+ * @return Pointer to @p length bytes to send: @p scratch, or memory that
+ *         stays unchanged until the stream has completed (zero-copy).
+ *         Must be 2-byte aligned, the data is read as native RGB565 pixels.
+ */
+typedef const uint8_t* (*LcdStreamFill)(void *context, uint8_t *scratch, uint32_t offset, uint32_t length);
+
+/**
+ * @brief Throughput of the streaming engine (items are bytes, time is from start to completion).
+ */
+extern Perf_Counter lcdStreamPerf;
+
+/**
+ * @brief Streams sent again from the start because a late buffer switch
+ *        interrupt may have let the DMA send stale data.
+ */
+extern uint32_t lcdStreamRestarts;
+
+/**
+ * @brief Starts streaming width * height pixels into a window of the panel.
+ * @details Waits for the previous transfer to finish, then returns as soon as
+ * the stream is running. Completion is signaled through lcdIsBusy() like any
+ * other framebuffer transfer.
+ * @param x       Window top-left X coordinate
+ * @param y       Window top-left Y coordinate
+ * @param width   Window width in pixels
+ * @param height  Window height in pixels
+ * @param fill    Data source, called for every piece of the stream in order,
+ *                from offset 0 again when the stream is restarted (see lcdStreamRestarts)
+ * @param context User pointer passed to @p fill
+ * @retval 1 if the stream was started, 0 on invalid arguments.
+ */
+uint8_t lcdStreamWindow(int x, int y, int width, int height, LcdStreamFill fill, void *context);
+
+/**
+ * @brief Fills a window of the panel with a solid color without touching the framebuffer.
+ * @param x      Window top-left X coordinate
+ * @param y      Window top-left Y coordinate
+ * @param width  Window width in pixels
+ * @param height Window height in pixels
+ * @param color  16-bit RGB565 color value
+ */
+void lcdStreamFillRect(int x, int y, int width, int height, uint16_t color);
+
+/**
+ * @brief Number of bytes of the running stream the DMA has already read.
+ * @details Derived from the NDTR counter of the DMA stream. The value may lag
+ * behind the real position but never runs ahead of it. Must be called with
+ * interrupts disabled when the stream can complete meanwhile.
+ * @return Byte offset within the stream, the stream length once it has completed.
+ */
+uint32_t lcdStreamGetPosition();
+
+/**
+ * @brief Must be called on completion of a normal SPI DMA transfer.
+ * @retval 1 if the stream continued with another transfer, 0 if the bus is free.
+ */
+uint8_t lcdStreamTransferComplete();
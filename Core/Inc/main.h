@@ -78,6 +78,9 @@ void Error_Handler(void);
 #define TCK_GPIO_Port GPIOA
 #define SWO_Pin GPIO_PIN_3
 #define SWO_GPIO_Port GPIOB
+#define LCD_TE_Pin GPIO_PIN_4
+#define LCD_TE_GPIO_Port GPIOB
+#define LCD_TE_EXTI_IRQn EXTI4_IRQn
 #define Brightness_LCD_Pin GPIO_PIN_8
 #define Brightness_LCD_GPIO_Port GPIOB
 
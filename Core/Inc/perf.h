@@ -0,0 +1,64 @@
+/*
+ * perf.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Lightweight cycle-accurate instrumentation based on the Cortex-M4
+ *  DWT cycle counter. Counters are plain structs so they can be inspected
+ *  from the debugger's live expressions view.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+/**
+ * @brief Accumulated timing statistics of a single measured operation.
+ */
+typedef struct {
+	uint32_t calls;        ///< Number of recorded measurements.
+	uint32_t lastCycles;   ///< Duration of the most recent measurement in CPU cycles.
+	uint32_t maxCycles;    ///< Longest recorded measurement in CPU cycles.
+	uint64_t totalCycles;  ///< Sum of all recorded durations in CPU cycles.
+	uint64_t totalItems;   ///< Sum of processed items (pixels, bytes...) over all measurements.
+} Perf_Counter;
+
+/**
+ * @brief Enables the DWT cycle counter.
+ *        Must be called once before any measurement is taken.
+ */
+void Perf_Init();
+
+/**
+ * @brief Returns the current value of the free running cycle counter.
+ */
+static inline uint32_t Perf_Now()
+{
+	return DWT->CYCCNT;
+}
+
+/**
+ * @brief Records a measurement that started at @p startCycles and ends now.
+ * @param counter     Counter to update.
+ * @param startCycles Value returned by Perf_Now() at the start of the operation.
+ * @param items       Number of items processed by the operation (0 if not applicable).
+ */
+void Perf_Record(Perf_Counter *counter, uint32_t startCycles, uint32_t items);
+
+/**
+ * @brief Clears all statistics of a counter.
+ */
+void Perf_Reset(Perf_Counter *counter);
+
+/**
+ * @brief Converts a cycle count to microseconds using the current core clock.
+ */
+uint32_t Perf_CyclesToUs(uint32_t cycles);
+
+/**
+ * @brief Average throughput of a counter.
+ * @return Processed items per second, or 0 if nothing was recorded yet.
+ */
+uint32_t Perf_ItemsPerSecond(const Perf_Counter *counter);
@@ -23,10 +23,73 @@
 #define HIGHLIGHT_COLOR 	  WHITE
 #define BACKGROUND_COLOR   	  BLACK
 
+#define UI_FRAME_PERIOD_MS    20   ///< Bound label updates are coalesced into one flush per period.
+#define UI_LABEL_TEXT_MAX     16   ///< Longest text of a dynamic label, terminator included.
+#define UI_LIST_TEXT_MAX      24   ///< Longest text of a list row, terminator included.
+#define UI_HISTORY_LENGTH     64   ///< DHT readings kept for the history page.
+
+/**
+ * @brief RAM for the compressed static layers of the pages, 0 disables them.
+ * @details A page background is its fill, constant labels and buttons in
+ * the normal state, run length coded by Ui_Idle() once the UI is idle.
+ * A flat page takes a few kilobytes, pages that do not fit anymore are
+ * rendered from scratch.
+ */
+#ifndef UI_BACKGROUND_POOL_BYTES
+#define UI_BACKGROUND_POOL_BYTES  16384
+#endif
+
+/**
+ * @brief Pixels saved beneath the open overlays, shared by all of them.
+ * @details The default holds a dialog with a toast on top of it. An overlay
+ * that does not fit is still shown, hiding it redraws the whole page.
+ */
+#ifndef UI_OVERLAY_SAVE_PIXELS
+#define UI_OVERLAY_SAVE_PIXELS    (140 * 50 + 120 * 20)
+#endif
+
+/**
+ * @brief Steps of the slide between pages, 0 switches pages with a cut.
+ * @details The panel scrolls the old page out in hardware, each step (one
+ * per UI_FRAME_PERIOD_MS) sends only the strip of the new page coming in,
+ * 1/8 of a frame with the default. The strip has to go out within one
+ * vertical blanking, see lcdCopyRectAndScroll(), larger panels need more
+ * steps. Panels without scroll registers and banded framebuffers always
+ * cut.
+ */
+#ifndef UI_TRANSITION_STEPS
+#define UI_TRANSITION_STEPS       8
+#endif
+
+#define UI_OVERLAY_DEPTH      2    ///< Overlays open at the same time.
+#define UI_NAV_DEPTH          8    ///< Pages remembered for Ui_GoBack(), the oldest is dropped first.
+#define UI_PRERENDER_IDLE_MS  200  ///< Time without input before pages are rendered ahead.
+#define UI_DEFERRED_INPUTS    4    ///< Input events kept while Ui_Idle() draws, later ones are dropped.
+#define UI_OVERLAY_RADIUS     6    ///< Corner radius of the overlay frames.
+
+/**
+ * @brief Raw value published by a data source (sensor, UART link, ...).
+ * @details Labels bound to the source are formatted and repainted by
+ * Ui_Idle() only when the value changed and the label is visible.
+ */
+typedef struct {
+    volatile float value;      ///< Last published value.
+    volatile uint32_t version; ///< Incremented every time the value changes, 0 before the first publication.
+} Ui_Source;
+
+/**
+ * @brief Converts a source value into the text of a bound label.
+ * @param text  Output buffer.
+ * @param size  Size of the output buffer.
+ * @param value Value to format.
+ */
+typedef void (*Ui_Formatter)(char *text, size_t size, float value);
+
 /**
  * @brief Structure representing a static label on the UI.
  *
- * This label displays fixed text that does not change at runtime.
+ * This label displays fixed text that does not change at runtime,
+ * it is only drawn together with the whole page.
  */
 typedef struct{
     uint8_t x;          ///< X position of the top-left corner of the label.
@@ -36,25 +99,58 @@ typedef struct{
     uint16_t bgColor;   ///< 16-bit background color in RGB565 format.
 } Label_Const;
 
+/**
+ * @brief Defines a color theme for UI elements.
+ * @details Contains colors for text and backgrounds, used for changing themes.
+ */
+typedef struct {
+    uint16_t textColor;     ///< The 16-bit text color (RGB565).
+    uint16_t bgColor;       ///< The 16-bit background color for buttons (RGB565).
+} Theme;
+
+/**
+ * @brief Runtime state of a dynamic label.
+ */
+typedef struct{
+    char drawn[UI_LABEL_TEXT_MAX]; ///< Characters currently in the box cells, compared with the new text on a repaint.
+    uint8_t dirty;      ///< The text changed, the label is repainted by the next partial update.
+    uint32_t version;   ///< Source version `dataPtr` was last formatted from.
+} Label_Dynamic_State;
+
 /**
  * @brief Structure representing a dynamic label on the UI.
  *
  * This label can display text that may change at runtime. The text
- * can be modified via the `dataPtr` pointer.
+ * can be modified via the `dataPtr` pointer. The label occupies a fixed
+ * box of `maxChars` glyph cells on a single line, longer texts are cut
+ * and the cells after a shorter text are cleared to `bgColor`. Only the
+ * cells whose character changed are redrawn and sent.
+ *
+ * The definition is constant and lives in flash, what changes at runtime
+ * is kept in the Label_Dynamic_State it points to.
  */
 typedef struct{
     uint8_t x;          ///< X position of the top-left corner of the label.
     uint8_t y;          ///< Y position of the top-left corner of the label.
-    char *text;         ///< Pointer to the text string displayed on the label.
+    const char *text;   ///< Pointer to the text string displayed on the label.
     uint16_t textColor; ///< 16-bit text color in RGB565 format.
     uint16_t bgColor;   ///< 16-bit background color in RGB565 format.
     char *dataPtr;      ///< Pointer to the dynamic data string used to update the label.
+    uint8_t maxChars;   ///< Width of the box in characters, below UI_LABEL_TEXT_MAX.
+
+    const Ui_Source *source; ///< Source the label is bound to, NULL for a label updated by hand.
+    Ui_Formatter format;     ///< Writes the source value into `dataPtr`.
+    size_t dataSize;         ///< Size of the `dataPtr` buffer.
+
+    Label_Dynamic_State *state; ///< Runtime state of the label, in RAM.
 } Label_Dynamic;
 
 /**
  * @brief Structure representing an interactive menu button.
  *
  * Contains all parameters necessary for drawing and handling user interaction.
+ * Buttons are constant and live in flash. Their colors come from a theme
+ * slot, so a theme change only stores a new Theme pointer into the slot.
  */
 typedef struct Button {
 	int x;                 ///< X position (top-left corner).
@@ -64,12 +160,53 @@ typedef struct Button {
 	int radius;            ///< The corner radius for the rounded rectangle.
 
 	const char *text;      ///< The text displayed on the button.
-	uint16_t textColor;    ///< 16-bit text color (RGB565).
-	uint16_t bgColor;      ///< 16-bit background color (RGB565).
+	const Theme * const *theme; ///< Theme slot providing the text and background colors.
 
-	void(*onClick)(struct Button *self);  ///< Pointer to the callback function executed upon press.
+	void(*onClick)(const struct Button *self);  ///< Pointer to the callback function executed upon press.
+	const struct Page *target;  ///< Page opened by a press instead of onClick, NULL for none.
 } Button;
 
+/**
+ * @brief Runtime state of a list.
+ */
+typedef struct {
+    uint32_t first;      ///< Item shown in the top row.
+    uint32_t selected;   ///< Highlighted item.
+    uint32_t count;      ///< Item count the rows were laid out for.
+    int32_t scroll;      ///< Rows the items moved up (negative: down) since the last repaint, the pixels follow on the repaint.
+    uint32_t dirtyRows;  ///< Rows to redraw, bit n for the n-th visible row.
+    uint32_t version;    ///< Source version the rows were drawn from.
+} Ui_List_State;
+
+/**
+ * @brief Scrolling list of text items provided by callbacks.
+ *
+ * Only the visible rows exist on the screen, an item is fetched by its
+ * index when a row shows it. Memory and the work of a scroll step do not
+ * depend on the number of items, a list may hold thousands of them.
+ * Scrolling by a row moves the pixels of the rows that stay visible and
+ * draws only the exposed one.
+ *
+ * On a page with a list the encoder moves the list selection, a short
+ * press selects the item and a long press clicks the highlighted button.
+ */
+typedef struct Ui_List {
+    int x;               ///< X position (top-left corner).
+    int y;               ///< Y position (top-left corner).
+    int width;           ///< Width of the rows.
+    int rowHeight;       ///< Height of one row, at least FONT_HEIGHT.
+    uint8_t rows;        ///< Number of visible rows, at most 32.
+    uint16_t textColor;  ///< 16-bit text color in RGB565 format.
+    uint16_t bgColor;    ///< 16-bit background color in RGB565 format, the selected row is inverted.
+
+    uint32_t (*count)(void);                                 ///< Returns the number of items.
+    void (*item)(uint32_t index, char *text, size_t size);   ///< Writes the text of an item.
+    void (*onSelect)(const struct Ui_List *self, uint32_t index); ///< Called on a short press, may be NULL.
+
+    const Ui_Source *source;  ///< Source announcing changes of the items, NULL if they never change.
+    Ui_List_State *state;     ///< Runtime state of the list, in RAM.
+} Ui_List;
+
 /**
  * @brief Represents a single screen or view in the UI.
  *
@@ -77,25 +214,48 @@ typedef struct Button {
  * on a particular screen, including buttons and labels.
  * This allows the UI to manage and render multiple pages independently.
  */
-typedef struct {
-    Button* const *buttons;        ///< Pointer to a constant array of pointers to Button structures on this page.
-    size_t buttonCount;             ///< The total number of buttons in the 'buttons' array.
+typedef struct Page {
+    const Button* const *buttons;  ///< Pointer to a constant array of pointers to Button structures on this page.
+    size_t buttonCount;             ///< The total number of buttons in the 'buttons' array, at most 32.
 
     const Label_Const* const *labels_Const; ///< Pointer to a constant array of pointers to static labels.
     size_t label_Const_Count;                ///< The number of static labels on this page.
 
-    Label_Dynamic* const *labels_Dynamic;   ///< Pointer to a constant array of pointers to dynamic labels.
+    const Label_Dynamic* const *labels_Dynamic; ///< Pointer to a constant array of pointers to dynamic labels.
     size_t label_Dynamic_Count;             ///< The number of dynamic labels on this page.
+
+    const Ui_List *list;                    ///< Scrolling list of the page, NULL for none.
+
+    LcdDisplay *display;                    ///< Display the page is shown on, NULL for the on-board display.
 } Page;
 
 /**
- * @brief Defines a color theme for UI elements.
- * @details Contains colors for text and backgrounds, used for changing themes.
+ * @brief Popup drawn over the current page: a modal dialog or a toast.
+ *
+ * Showing an overlay saves the framebuffer pixels beneath it, hiding it
+ * copies them back, only the overlay rectangle is sent both times.
+ * While an overlay is open the page below is not repainted, its pending
+ * changes are applied when the last overlay hides.
+ *
+ * The topmost overlay gets the input first. A dialog keeps the focus until
+ * a short press confirms it or a long press cancels it, encoder steps are
+ * ignored. A toast hides after `timeoutMs` or on any input, which then
+ * goes on to the page.
  */
-typedef struct {
-    uint16_t textColor;     ///< The 16-bit text color (RGB565).
-    uint16_t bgColor;       ///< The 16-bit background color for buttons (RGB565).
-} Theme;
+typedef struct Ui_Overlay {
+    int x;               ///< X position (top-left corner).
+    int y;               ///< Y position (top-left corner).
+    int width;           ///< The width of the overlay.
+    int height;          ///< The height of the overlay.
+
+    const char *title;   ///< First line of text, NULL for a single line overlay.
+    const char *message; ///< Last line of text, may point to a buffer filled before Ui_ShowOverlay().
+    uint16_t textColor;  ///< 16-bit text and frame color in RGB565 format.
+    uint16_t bgColor;    ///< 16-bit background color in RGB565 format.
+
+    uint32_t timeoutMs;  ///< Time a toast stays shown, 0 for a modal dialog.
+    void (*onConfirm)(const struct Ui_Overlay *self); ///< Called after a short press hid the dialog, may be NULL.
+} Ui_Overlay;
 
 /**
  * @brief Draws the entire UI menu using predefined global Button_menu instances.
@@ -106,22 +266,74 @@ typedef struct {
 void Ui_DrawPage();
 
 /**
- * @brief Sets a new page as the active view, resetting the highlight state.
+ * @brief Cache effectiveness of the page backgrounds on page switches.
+ * @details Backgrounds of the pages reachable from the focused one are
+ * rendered ahead while the UI is idle. The hit rate is
+ * hits / (hits + misses), cyclesSaved is the time the hits did not spend
+ * rendering the static layer, decoding it subtracted.
+ */
+typedef struct {
+    uint32_t hits;         ///< Switches to a page whose background was ready.
+    uint32_t misses;       ///< Switches that rendered the page from scratch.
+    uint32_t prerendered;  ///< Backgrounds rendered ahead in idle time.
+    uint64_t cyclesSaved;  ///< Render cycles avoided by the hits, see Perf_CyclesToUs().
+} Ui_PrerenderStats;
+
+extern Ui_PrerenderStats uiPrerenderStats;
+
+/**
+ * @brief Sets a new page as the root of the navigation, Ui_GoBack() has nowhere to go.
+ * @details The highlight returns to the button focused when the page was last shown.
  * @param newPage Pointer to the Page structure to activate.
  */
 void Ui_SetCurrentPage(const Page *newPage);
 
 /**
- * @brief Changes the background and text color theme for ALL buttons in the application.
- * * Ui_DrawPage is called afterwards for changes to become visible.
- * @param btnTextColor New 16-bit text color (RGB565).
- * @param btnBgColor New 16-bit background color (RGB565).
+ * @brief Shows a page and remembers the current one for Ui_GoBack().
+ * @details The page slides in from the right, see UI_TRANSITION_STEPS.
+ * @param page Page to show.
+ */
+void Ui_OpenPage(const Page *page);
+
+/**
+ * @brief Returns to the page shown before the last Ui_OpenPage(), with its focus and scroll position.
+ * @details The page slides back in from the left.
+ * @param fallback Page shown when there is nothing to go back to.
+ */
+void Ui_GoBack(const Page *fallback);
+
+/**
+ * @brief Changes the theme of ALL menu buttons in the application.
+ * * Only the menu theme slot is updated, the buttons of the current page are
+ * repainted afterwards, the rest of the page is kept.
+ * @param theme New theme, must stay valid while it is in use (usually a const table entry).
  */
-void Ui_ChangeMenuTheme( uint16_t btnTextColor, uint16_t btnBgColor);
+void Ui_ChangeMenuTheme(const Theme *theme);
+
+/**
+ * @brief Opens an overlay on top of the current page and the open overlays.
+ * @details Showing the topmost overlay again redraws its text and restarts
+ * its timeout. Ignored when UI_OVERLAY_DEPTH overlays are open.
+ * @param overlay Overlay to show, must stay valid while it is open.
+ */
+void Ui_ShowOverlay(const Ui_Overlay *overlay);
+
+/**
+ * @brief Closes the topmost overlay and restores what was beneath it.
+ */
+void Ui_HideOverlay();
+
+/**
+ * @brief Gives the overlay holding the focus.
+ * @return The topmost open overlay, NULL if none is open.
+ */
+const Ui_Overlay* Ui_GetOverlay();
 
 /**
  * @brief Moves the highlight (cursor) to the next button in the list.
  * * If the highlight reaches the end of the list, it wraps back to the first element.
+ * Only the previously and the newly highlighted buttons are repainted.
+ * On a page with a list the list selection moves instead, without wrapping.
  */
 void Ui_MoveHighlight(uint8_t dirDown);
 
@@ -148,13 +360,58 @@ void Ui_MoveActionDetected(uint8_t dirDown);
 /**
  * @brief Update the UI with the latest DHT11 sensor readings.
  *
- * This function formats the temperature and humidity values into strings
- * and updates the corresponding dynamic labels on the sensors page.
- * If the currently displayed page is the sensors page, the labels
- * are redrawn and the LCD buffer is copied to the screen.
+ * This function only publishes the raw values to the temperature and
+ * humidity sources. The bound labels of the sensors page are formatted
+ * and repainted by Ui_Idle() when the page is shown and a value changed.
  *
  * @param temperature The current temperature in Celsius.
  * @param humidity The current relative humidity in percent.
  */
 void Ui_UpdateDHTData(float temperature, float humidity);
 
+/**
+ * @brief Publishes a new value of a source.
+ * @details Cheap enough to be called for every sample, nothing is formatted
+ * nor drawn here. Publishing the same value again is ignored.
+ * @param source Source to update.
+ * @param value  New raw value.
+ */
+void Ui_Publish(Ui_Source *source, float value);
+
+/**
+ * @brief Paces the frames of the user interface.
+ * @details Once per UI_FRAME_PERIOD_MS it marks a frame due, drawn by the
+ * next Ui_Idle(). Nothing is drawn here. Call it from the SysTick handler.
+ */
+void Ui_Process();
+
+/**
+ * @brief Draws the user interface from the main loop.
+ * @details Handles first the input events that arrived while it was
+ * drawing. Then, when Ui_Process() marked a frame due, the labels of the
+ * current page whose source changed are formatted, the ones whose text
+ * differs are repainted and all of them are sent by a single flush. A
+ * running slide goes one step further, an expired toast is hidden and a
+ * banded page dropped during the bring-up or the sleep is drawn again.
+ * Last, after UI_PRERENDER_IDLE_MS without input, it renders the
+ * background of the current page, then of the pages reachable from the
+ * focus, ahead of time, see Ui_PrerenderStats. While it draws, input
+ * events from the interrupts are kept for the next call. Call it from the
+ * main loop.
+ */
+void Ui_Idle();
+
+/**
+ * @brief Cost of the partial updates (highlight moves, theme changes, label
+ *        refreshes), one record per interaction, items are repainted pixels.
+ * @details The matching transfer cost is in lcdRectTransferPerf, full page
+ * draws are measured by lcdFramePerf.
+ */
+extern Perf_Counter uiRepaintPerf;
+
+/**
+ * @brief Cost of the page slides, one record per step, items are sent pixels.
+ * @details Includes waiting for the strip transfer before the scroll offset moves.
+ */
+extern Perf_Counter uiTransitionPerf;
+
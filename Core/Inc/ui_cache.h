@@ -0,0 +1,96 @@
+/*
+ * ui_cache.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Render cache of widget images. The first time a widget is painted in
+ *  a given state (e.g. normal or highlighted) its pixels are copied from
+ *  the framebuffer into a slot of a fixed pool, later paints of the same
+ *  state copy the slot back instead of rasterizing the widget again.
+ *  Slots come in two sizes, a widget takes a slot of the smallest size it
+ *  fits. Slots are reused least recently used first, a theme change drops
+ *  them.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "lcd.h"
+#include "ui.h"
+
+/**
+ * @brief Number of large slots, for the menu buttons.
+ * @details The defaults hold both states of every button of the largest
+ * page (settings: three menu buttons and the return button), about 34 KB.
+ * A page with more buttons than the slots have room for evicts on every
+ * highlight move and gets no hits at all. 0 for both slot counts disables
+ * the cache.
+ */
+#ifndef UI_CACHE_SLOTS
+#define UI_CACHE_SLOTS 6
+#endif
+
+/**
+ * @brief Size of one large slot in pixels, larger widgets are never cached.
+ */
+#ifndef UI_CACHE_SLOT_PIXELS
+#define UI_CACHE_SLOT_PIXELS (BTN_DEFAULT_WIDTH * BTN_DEFAULT_HEIGHT)
+#endif
+
+/**
+ * @brief Number of small slots, for the return buttons.
+ */
+#ifndef UI_CACHE_SMALL_SLOTS
+#define UI_CACHE_SMALL_SLOTS 2
+#endif
+
+/**
+ * @brief Size of one small slot in pixels.
+ */
+#ifndef UI_CACHE_SMALL_SLOT_PIXELS
+#define UI_CACHE_SMALL_SLOT_PIXELS (BTN_RETURN_WIDTH * BTN_RETURN_HEIGHT)
+#endif
+
+/** @brief Total number of slots. */
+#define UI_CACHE_ENTRIES (UI_CACHE_SLOTS + UI_CACHE_SMALL_SLOTS)
+
+/**
+ * @brief Effectiveness and memory use of the cache.
+ * @details The hit rate is hits / (hits + misses). The time spent copying
+ * images in and out is in lcdBlitPerf.
+ */
+typedef struct {
+	uint32_t hits;         ///< Paints served from the cache.
+	uint32_t misses;       ///< Paints that had to rasterize the widget.
+	uint32_t evictions;    ///< Images dropped to make room for another one.
+	uint32_t flushes;      ///< Calls of Ui_CacheInvalidate().
+	uint32_t usedBytes;    ///< Pixel memory of the images currently held.
+	uint32_t poolBytes;    ///< Pixel memory reserved for the pool.
+} Ui_CacheStats;
+
+extern Ui_CacheStats uiCacheStats;
+
+/**
+ * @brief Paints a cached widget image.
+ * @param widget Widget identity, usually its definition pointer.
+ * @param state  Visual state of the widget (e.g. 1 when highlighted).
+ * @param area   Screen rectangle of the widget.
+ * @retval 1 if the image was cached and drawn, 0 if the widget has to be rasterized.
+ */
+uint8_t Ui_CacheDraw(const void *widget, uint8_t state, const LcdRect *area);
+
+/**
+ * @brief Stores the widget just rasterized in the framebuffer.
+ * @details The widget must be opaque over its whole rectangle, what is
+ * below it in the framebuffer ends up in the image.
+ * @param widget Widget identity, as passed to Ui_CacheDraw().
+ * @param state  Visual state the widget was drawn in.
+ * @param area   Screen rectangle of the widget.
+ */
+void Ui_CacheStore(const void *widget, uint8_t state, const LcdRect *area);
+
+/**
+ * @brief Drops all images, call it when the widgets change their look (e.g. theme switch).
+ */
+void Ui_CacheInvalidate();
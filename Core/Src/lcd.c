@@ -5,151 +5,1588 @@
  *      Author: wojte
  */
 #include <stdlib.h>
+#include <limits.h>
 #include "lcd.h"
+#include "lcd_internal.h"
+#include "lcd_panel.h"
+#include "lcd_stream.h"
 #include "stm32f4xx_hal.h"
 #include "spi.h"
 
-#define CMD(x) ((x) | 0x100)
-#define ST7735S_SLPOUT			0x11
-#define ST7735S_DISPOFF			0x28
-#define ST7735S_DISPON			0x29
-#define ST7735S_CASET			0x2a
-#define ST7735S_RASET			0x2b
-#define ST7735S_RAMWR			0x2c
-#define ST7735S_MADCTL			0x36
-#define ST7735S_COLMOD			0x3a
-#define ST7735S_FRMCTR1			0xb1
-#define ST7735S_FRMCTR2			0xb2
-#define ST7735S_FRMCTR3			0xb3
-#define ST7735S_INVCTR			0xb4
-#define ST7735S_PWCTR1			0xc0
-#define ST7735S_PWCTR2			0xc1
-#define ST7735S_PWCTR3			0xc2
-#define ST7735S_PWCTR4			0xc3
-#define ST7735S_PWCTR5			0xc4
-#define ST7735S_VMCTR1			0xc5
-#define ST7735S_GAMCTRP1		0xe0
-#define ST7735S_GAMCTRN1		0xe1
+// bring-up timings (ST7735S datasheet: reset low >= 10 us, 120 ms after reset
+// and after sleep out, 5 ms after sleep out before the next command)
+#define LCD_RESET_PULSE_MS			2
+#define LCD_RESET_WAIT_MS			120
+#define LCD_SLPOUT_CMD_WAIT_MS		5
+#define LCD_SLPOUT_WAIT_MS			120
+#define LCD_SLPIN_WAIT_MS			5
 
-#define LCD_OFFSET_X 0
-#define LCD_OFFSET_Y 0
+// longest wait of an armed flush for its tearing effect event, a few
+// refresh periods, before it is sent unsynchronized
+#define LCD_VSYNC_TIMEOUT_MS		50
 
+/**
+ * @brief States of the non-blocking display bring-up.
+ */
+typedef enum {
+	LCD_INIT_IDLE,               /**< lcdInitStart() was not called yet. */
+	LCD_INIT_RESET_PULSE,        /**< Reset line held low. */
+	LCD_INIT_RESET_WAIT,         /**< Reset released, controller is booting. */
+	LCD_INIT_SLEEP_OUT,          /**< SLPOUT sent, waiting before the next command. */
+	LCD_INIT_SLEEP_OUT_SETTLE,   /**< Init table sent, waiting for the sleep out to complete. */
+	LCD_INIT_FIRST_FRAME,        /**< Pending frame is being written, display still off. */
+	LCD_INIT_READY,              /**< Display is on and accepts flushes. */
+	LCD_INIT_SLEEP_IN,           /**< SLPIN sent, waiting before SLPOUT may follow. */
+	LCD_INIT_SLEEPING,           /**< Sleep mode, registers and RAM are retained. */
+	LCD_INIT_WAKE_UP             /**< SLPOUT sent, waiting for the booster to settle. */
+} LcdInitState;
+
+/**
+ * @brief Rows of the framebuffer sent to the panel by one transfer.
+ */
+typedef struct {
+	const uint16_t *pixels;  ///< First pixel of the band in the framebuffer.
+	int x;                   ///< First screen column, non-zero only for lcdCopyRect().
+	int y;                   ///< First screen row of the band.
+	int width;               ///< Number of columns.
+	int rows;                ///< Number of rows.
+} LcdBand;
+
+/**
+ * @brief Wiring and state of one display.
+ */
+struct LcdDisplay {
+	LcdDisplayConfig config;            ///< Bus, control pins and framebuffer memory.
+	const LcdPanel *panel;              ///< Panel driver.
+	volatile uint8_t spiBusy;           ///< A DMA transfer to the panel is running.
+
+	volatile LcdInitState initState;
+	uint32_t initTimestamp;
+	volatile uint8_t flushPending;
+	LcdRect flushArea;                  ///< Area requested by the pending flush, width 0 when none.
+	uint8_t sendingRect;                ///< The running transfer was narrowed by lcdCopyRect().
+	uint32_t timeToFirstFrameMs;
+
+	LcdPresentMode presentMode;
+	LcdTeSource teSource;
+	uint8_t teConfigured;               ///< The source was set by lcdSetTearingEffectSource(), the board delivers the events.
+	uint32_t tePeriodMs;
+	uint32_t teTimestamp;
+	volatile uint8_t flushArmed;        ///< A TE synchronized flush waits for the next tearing effect event.
+	uint32_t armCycles;                 ///< Perf_Now() at the moment the flush was armed.
+
+	uint8_t idleMode;                   ///< Idle (8 color) mode is on.
+	uint16_t partialFirst;              ///< First scan line of the partial area.
+	uint16_t partialCount;              ///< Scan lines of the partial area, 0 in normal mode.
+	uint16_t scrollOffset;              ///< Scan lines the picture is rotated by, see lcdSetScrollOffset().
+	volatile uint8_t scrollArmed;       ///< scrollOffset is sent once the armed flush has landed, see lcdCopyRectAndScroll().
+	uint8_t teForced;                   ///< TE output turned on by lcdCopyRectAndScroll() outside LCD_PRESENT_TE_SYNC.
+	volatile uint8_t teSkip;            ///< Tearing effect events to ignore, the first one after TEON may come mid-blanking.
+	uint8_t frameRate;                  ///< Requested refresh rate in Hz, 0 keeps the init table setting.
+	volatile uint8_t wakeRequested;     ///< lcdWake() was called while SLPIN was settling.
+	uint32_t sleepCycles;               ///< Perf_Now() at lcdSleep().
+	uint32_t wakeCycles;                ///< Perf_Now() at lcdWake().
+
+	int bufferRows;                     ///< Number of rows the framebuffer holds for the current panel.
+	int bandRows;                       ///< Number of rows of one band (bufferRows, half of it when pipelined).
+	int bandY;                          ///< First screen row held in the framebuffer (always 0 unless banded).
+	uint16_t *drawBuffer;               ///< Part of the framebuffer the current band is drawn into.
+	uint8_t frameDropped;               ///< The last banded frame was not sent, see lcdIsFrameDropped().
+
+	uint8_t pipelined;                  ///< The framebuffer is split into two bands, one drawn while the other is sent.
+	LcdBand sending;                    ///< Band sent by the running framebuffer transfer.
+	LcdBand queued;                     ///< Band waiting for the running transfer to complete.
+	volatile uint8_t bandQueued;
+
+	uint32_t frameStartCycles;
+	uint32_t renderStartCycles;
+	uint32_t transferStartCycles;
+	uint8_t frameTimed;                 ///< lcdFramePerf is recorded when the last band of the frame has been sent.
+
+	uint8_t raceTheBeam;                ///< Drawing waits for the rows still read by the running transfer.
+	volatile uint8_t scanoutActive;     ///< Non-zero while the DMA reads the framebuffer.
+	uint8_t scanoutStreamed;            ///< The running framebuffer transfer goes through lcdStreamWindow().
+	uint32_t scanoutBytes;              ///< Length of the running framebuffer transfer in bytes.
+	volatile int scanoutSafeRow;        ///< Rows above this one may be drawn without waiting (INT_MAX when nothing is read).
+
+	LcdRect userClipRect;               ///< Clip rectangle requested by the user.
+	LcdRect clipRect;                   ///< User clip intersected with the resident band, used for drawing.
+	const LcdStencil *stencil;          ///< Shape drawing is limited to, NULL for none.
+};
+
+Perf_Counter lcdVsyncWaitPerf;
+Perf_Counter lcdScanoutWaitPerf;
+Perf_Counter lcdBandRenderPerf;
+Perf_Counter lcdBandTransferPerf;
+Perf_Counter lcdBandStallPerf;
+Perf_Counter lcdFramePerf;
+Perf_Counter lcdRectTransferPerf;
+Perf_Counter lcdPowerEnterPerf[LCD_POWER_MODE_COUNT];
+Perf_Counter lcdPowerExitPerf[LCD_POWER_MODE_COUNT];
+
+static void lcdStartTransfer();
+static void lcdFlush();
+static void lcdTransferBand(const LcdBand *band);
+static void lcdApplyPresentMode();
+static void lcdApplyPowerMode();
+
+static uint16_t frameBuffer[LCD_FRAMEBUFFER_PIXELS];
+
+#define LCD_DISPLAY_DEFAULTS \
+		.initState = LCD_INIT_IDLE, \
+		.presentMode = LCD_PRESENT_IMMEDIATE, \
+		.teSource = LCD_TE_SOURCE_PIN, \
+		.scanoutSafeRow = INT_MAX
+
+static LcdDisplay displays[LCD_MAX_DISPLAYS] = {
+	{
+		// the on-board display, available without lcdAddDisplay()
+		.config = {
+			.spi = &hspi2,
+			.csPort = LCD_CS_GPIO_Port,
+			.csPin = LCD_CS_Pin,
+			.dcPort = LCD_DC_GPIO_Port,
+			.dcPin = LCD_DC_Pin,
+			.rstPort = LCD_RST_GPIO_Port,
+			.rstPin = LCD_RST_Pin,
+			.tePin = LCD_TE_Pin,
+			.frameBuffer = frameBuffer,
+			.frameBufferPixels = LCD_FRAMEBUFFER_PIXELS,
+		},
+		.panel = &lcdPanelST7735S,
+		.drawBuffer = frameBuffer,
+		LCD_DISPLAY_DEFAULTS,
+	},
+};
+static uint8_t displayCount = 1;
+
+/// @brief Display all lcd* calls operate on.
+static LcdDisplay *display = &displays[0];
+
+/// @brief Stencil filled pixels are added to, NULL when they are drawn.
+static LcdStencil *captureStencil = NULL;
+/// @brief Display list recording suspended by lcdStencilBegin().
+static LcdDisplayList *captureRecordTarget = NULL;
+
+static void lcdUpdateClipRect();
+static void lcdWaitForScanout(int y);
+
+/**
+ * @brief Switches the bus of the selected display between 8-bit frames
+ *        (commands, parameters) and 16-bit frames (pixels).
+ * @details 16-bit frames put the native RGB565 values on the wire most
+ * significant byte first, as the controllers expect.
+ */
+static void lcdSetSpiDataSize(uint32_t dataSize)
+{
+	SPI_HandleTypeDef *spi = display->config.spi;
+
+	if(spi->Init.DataSize == dataSize) return;
+
+	// DFF may only be changed while the SPI is disabled
+	__HAL_SPI_DISABLE(spi);
+	MODIFY_REG(spi->Instance->CR1, SPI_CR1_DFF, dataSize);
+	spi->Init.DataSize = dataSize;
+}
+
+void lcdCmd(uint8_t cmd)
+{
+	lcdSetSpiDataSize(SPI_DATASIZE_8BIT);
+	HAL_GPIO_WritePin(display->config.dcPort, display->config.dcPin, GPIO_PIN_RESET);
+	HAL_GPIO_WritePin(display->config.csPort, display->config.csPin, GPIO_PIN_RESET);
+	HAL_SPI_Transmit(display->config.spi, &cmd, 1, HAL_MAX_DELAY);
+	HAL_GPIO_WritePin(display->config.csPort, display->config.csPin, GPIO_PIN_SET);
+}
+
+void lcdData(uint8_t data)
+{
+	lcdSetSpiDataSize(SPI_DATASIZE_8BIT);
+	HAL_GPIO_WritePin(display->config.dcPort, display->config.dcPin, GPIO_PIN_SET);
+	HAL_GPIO_WritePin(display->config.csPort, display->config.csPin, GPIO_PIN_RESET);
+	HAL_SPI_Transmit(display->config.spi, &data, 1, HAL_MAX_DELAY);
+	HAL_GPIO_WritePin(display->config.csPort, display->config.csPin, GPIO_PIN_SET);
+}
+
+void lcdSend(uint16_t value)
+{
+	if(value & 0x100)
+	{
+		lcdCmd(value);
+	} else
+	{
+		lcdData(value);
+	}
+}
+
+void lcdData16(uint16_t value)
+{
+	lcdData(value >> 8);
+	lcdData(value);
+}
+
+static void lcdSetWindow(int x, int y, int width, int height)
+{
+	display->panel->setWindow(display->panel, x, y, width, height);
+}
+
+/**
+ * @brief Tells whether the controller RAM is written in gate scan order
+ *        with rows and columns exchanged against the screen coordinates.
+ */
+static uint8_t lcdIsScanTransposed()
+{
+	return display->presentMode == LCD_PRESENT_TE_SYNC && (display->panel->madctl & LCD_MADCTL_MV);
+}
+
+static void lcdSetWindowTransposed(int x, int y, int width, int height)
+{
+	// with MV cleared the screen rows are the controller columns
+	lcdCmd(LCD_CMD_CASET);
+	lcdData16(display->panel->offsetY + y);
+	lcdData16(display->panel->offsetY + y + height - 1);
+
+	lcdCmd(LCD_CMD_RASET);
+	lcdData16(display->panel->offsetX + x);
+	lcdData16(display->panel->offsetX + x + width - 1);
+}
+
+void lcdSetPanel(const LcdPanel *newPanel)
+{
+	if(newPanel == NULL) return;
+
+	display->panel = newPanel;
+
+	display->bufferRows = display->config.frameBufferPixels / display->panel->width;
+	if(display->bufferRows > display->panel->height)
+	{
+		display->bufferRows = display->panel->height;
+	}
+
+	display->bandRows = display->pipelined ? display->bufferRows / 2 : display->bufferRows;
+	display->bandY = 0;
+	display->drawBuffer = display->config.frameBuffer;
+	lcdResetClipRect();
+}
+
+void lcdSetPipelined(uint8_t enable)
+{
+	lcdWaitForTransfer();
+	display->pipelined = enable;
+	lcdSetPanel(display->panel);
+}
+
+LcdDisplay* lcdAddDisplay(const LcdDisplayConfig *config, const LcdPanel *newPanel)
+{
+	if(config == NULL || config->spi == NULL || config->frameBuffer == NULL || newPanel == NULL) return NULL;
+	if(displayCount >= LCD_MAX_DISPLAYS) return NULL;
+
+	LcdDisplay *added = &displays[displayCount];
+	*added = (LcdDisplay){
+		.config = *config,
+		.panel = newPanel,
+		.drawBuffer = config->frameBuffer,
+		LCD_DISPLAY_DEFAULTS,
+	};
+
+	LcdDisplay *selected = lcdSelectDisplay(added);
+	lcdSetPanel(newPanel);
+	lcdSelectDisplay(selected);
+
+	// the interrupt callbacks look it up from now on
+	displayCount++;
+	return added;
+}
+
+LcdDisplay* lcdSelectDisplay(LcdDisplay *selected)
+{
+	LcdDisplay *previous = display;
+	if(selected != NULL)
+	{
+		display = selected;
+	}
+	return previous;
+}
+
+LcdDisplay* lcdGetDisplay()
+{
+	return display;
+}
+
+LcdDisplay* lcdGetDefaultDisplay()
+{
+	return &displays[0];
+}
+
+uint8_t lcdGetDisplayIndex()
+{
+	return (uint8_t)(display - displays);
+}
+
+SPI_HandleTypeDef* lcdGetSpi()
+{
+	return display->config.spi;
+}
+
+void lcdSetSpiBusy()
+{
+	display->spiBusy = 1;
+}
+
+uint8_t lcdIsBusy()
+{
+	return display->spiBusy || display->flushArmed;
+}
+
+const LcdPanel* lcdGetPanel()
+{
+	return display->panel;
+}
+
+int lcdGetWidth()
+{
+	return display->panel->width;
+}
+
+int lcdGetHeight()
+{
+	return display->panel->height;
+}
+
+uint8_t lcdIsBanded()
+{
+	return display->bandRows < display->panel->height;
+}
+
+void lcdInit()
+{
+	lcdInitStart();
+
+	while(!lcdIsReady())
+	{
+		lcdProcess();
+	}
+}
+
+void lcdInitStart()
+{
+	if(display->bufferRows == 0)
+	{
+		lcdSetPanel(display->panel);
+	}
+
+	HAL_GPIO_WritePin(display->config.rstPort, display->config.rstPin, GPIO_PIN_RESET);
+	display->wakeRequested = 0;
+	display->initTimestamp = HAL_GetTick();
+	display->initState = LCD_INIT_RESET_PULSE;
+}
+
+static void lcdHandleTearingEffect();
+static void lcdCheckVsyncTimeout();
+
+/**
+ * @brief Advances the bring-up of the selected display.
+ */
+static void lcdProcessDisplay()
+{
+	uint32_t elapsed = HAL_GetTick() - display->initTimestamp;
+
+	switch(display->initState)
+	{
+	case LCD_INIT_RESET_PULSE:
+		if(elapsed >= LCD_RESET_PULSE_MS)
+		{
+			HAL_GPIO_WritePin(display->config.rstPort, display->config.rstPin, GPIO_PIN_SET);
+			display->initTimestamp = HAL_GetTick();
+			display->initState = LCD_INIT_RESET_WAIT;
+		}
+		break;
+
+	case LCD_INIT_RESET_WAIT:
+		if(elapsed >= LCD_RESET_WAIT_MS)
+		{
+			lcdCmd(LCD_CMD_SLPOUT); // wake up
+			display->initTimestamp = HAL_GetTick();
+			display->initState = LCD_INIT_SLEEP_OUT;
+		}
+		break;
+
+	case LCD_INIT_SLEEP_OUT:
+		if(elapsed >= LCD_SLPOUT_CMD_WAIT_MS)
+		{
+			// configure the controller while the booster is still settling
+			display->panel->sendInitSequence(display->panel);
+			lcdApplyPresentMode();
+			lcdApplyPowerMode();
+			display->initState = LCD_INIT_SLEEP_OUT_SETTLE;
+		}
+		break;
+
+	case LCD_INIT_SLEEP_OUT_SETTLE:
+		if(elapsed >= LCD_SLPOUT_WAIT_MS)
+		{
+			display->initState = LCD_INIT_FIRST_FRAME;
+			if(display->flushPending)
+			{
+				// write the pre-rendered frame before the panel is turned on,
+				// the panel RAM holds garbage so it is always sent whole
+				display->flushPending = 0;
+				display->flushArea.width = 0;
+				lcdStartTransfer();
+			}
+		}
+		break;
+
+	case LCD_INIT_FIRST_FRAME:
+		if(!display->spiBusy)
+		{
+			lcdCmd(LCD_CMD_DISPON); // turn on display
+			display->timeToFirstFrameMs = HAL_GetTick();
+			display->initState = LCD_INIT_READY;
+
+			if(display->flushPending)
+			{
+				lcdFlush();
+			}
+		}
+		break;
+
+	case LCD_INIT_SLEEP_IN:
+		if(elapsed >= LCD_SLPIN_WAIT_MS)
+		{
+			Perf_Record(&lcdPowerEnterPerf[LCD_POWER_SLEEP], display->sleepCycles, 0);
+			display->initState = LCD_INIT_SLEEPING;
+		}
+		break;
+
+	case LCD_INIT_SLEEPING:
+		if(display->wakeRequested)
+		{
+			display->wakeRequested = 0;
+			lcdCmd(LCD_CMD_SLPOUT);
+			display->initTimestamp = HAL_GetTick();
+			display->initState = LCD_INIT_WAKE_UP;
+		}
+		break;
+
+	case LCD_INIT_WAKE_UP:
+		if(elapsed >= LCD_SLPOUT_WAIT_MS)
+		{
+			display->initState = LCD_INIT_READY;
+			Perf_Record(&lcdPowerExitPerf[LCD_POWER_SLEEP], display->wakeCycles, 0);
+
+			// frames drawn during the sleep
+			if(display->flushPending)
+			{
+				lcdFlush();
+			}
+		}
+		break;
+
+	case LCD_INIT_READY:
+	default:
+		break;
+	}
+
+	if(display->teSource == LCD_TE_SOURCE_SOFTWARE && HAL_GetTick() - display->teTimestamp >= display->tePeriodMs)
+	{
+		display->teTimestamp = HAL_GetTick();
+		lcdHandleTearingEffect();
+	}
+
+	lcdCheckVsyncTimeout();
+}
+
+void lcdProcess()
+{
+	LcdDisplay *selected = display;
+
+	for(uint8_t i = 0; i < displayCount; i++)
+	{
+		display = &displays[i];
+		lcdProcessDisplay();
+	}
+
+	display = selected;
+}
+
+uint8_t lcdIsReady()
+{
+	return display->initState == LCD_INIT_READY;
+}
+
+uint32_t lcdGetTimeToFirstFrameMs()
+{
+	return display->timeToFirstFrameMs;
+}
+
+static void lcdStencilAddPixel(int x, int y)
+{
+	unsigned row = (unsigned)(y - captureStencil->top);
+	if(row >= captureStencil->capacity) return;
+
+	LcdSpan *span = &captureStencil->spans[row];
+	if(span->x1 <= span->x0)
+	{
+		span->x0 = x;
+		span->x1 = x + 1;
+	}
+	else if(x < span->x0)
+	{
+		span->x0 = x;
+	}
+	else if(x >= span->x1)
+	{
+		span->x1 = x + 1;
+	}
+}
+
+void lcdFillPixel(int x, int y, uint16_t color)
+{
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_FILL_PIXEL, 3, x, y, color);
+		return;
+	}
+
+	if(captureStencil)
+	{
+		lcdStencilAddPixel(x, y);
+		return;
+	}
+
+	if(x < display->clipRect.x || y < display->clipRect.y ||
+	   x >= display->clipRect.x + display->clipRect.width || y >= display->clipRect.y + display->clipRect.height)
+	{
+		return;
+	}
+
+	if(display->stencil)
+	{
+		const LcdStencil *stencil = display->stencil;
+		unsigned row = (unsigned)(y - stencil->top);
+
+		if(row >= stencil->capacity || x < stencil->spans[row].x0 || x >= stencil->spans[row].x1) return;
+	}
+
+	if(y >= display->scanoutSafeRow)
+	{
+		lcdWaitForScanout(y);
+	}
+
+	display->drawBuffer[x + (y - display->bandY) * display->panel->width] = color;
+}
+
+uint16_t* lcdFrameBufferRow(int y)
+{
+	if(y >= display->scanoutSafeRow)
+	{
+		lcdWaitForScanout(y);
+	}
+
+	return &display->drawBuffer[(y - display->bandY) * display->panel->width];
+}
+
+const uint16_t* lcdGetFrameBuffer()
+{
+	return lcdIsBanded() ? NULL : display->config.frameBuffer;
+}
+
+int lcdGetScanoutRow()
+{
+	if(!display->scanoutActive) return display->panel->height;
+
+	if(lcdIsScanTransposed())
+	{
+		// sent column by column, no row is complete before the end
+		return display->sending.y;
+	}
+
+	uint32_t sent;
+	if(display->scanoutStreamed)
+	{
+		sent = lcdStreamGetPosition();
+	}
+	else
+	{
+		// the DMA counts 16-bit frames
+		sent = display->scanoutBytes - display->config.spi->hdmatx->Instance->NDTR * 2;
+	}
+
+	return display->sending.y + sent / (display->sending.width * display->panel->bytesPerPixel);
+}
+
+static void lcdUpdateScanoutSafeRow()
+{
+	// the transfer can complete or a new one can start from an interrupt
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	display->scanoutSafeRow = (display->raceTheBeam && display->scanoutActive) ? lcdGetScanoutRow() : INT_MAX;
+	__set_PRIMASK(primask);
+}
+
+static void lcdWaitForScanout(int y)
+{
+	uint32_t start = Perf_Now();
+
+	lcdUpdateScanoutSafeRow();
+	if(y < display->scanoutSafeRow) return;
+
+	while(y >= display->scanoutSafeRow)
+	{
+		if(__get_IPSR() != 0U)
+		{
+			// see lcdWaitForTransfer()
+			HAL_DMA_IRQHandler(display->config.spi->hdmatx);
+		}
+		lcdUpdateScanoutSafeRow();
+	}
+
+	Perf_Record(&lcdScanoutWaitPerf, start, 1);
+}
+
+void lcdSetRaceTheBeam(uint8_t enable)
+{
+	lcdWaitForTransfer();
+	display->raceTheBeam = enable;
+}
+
+static void lcdUpdateClipRect()
+{
+	int x0 = display->userClipRect.x;
+	int y0 = display->userClipRect.y;
+	int x1 = display->userClipRect.x + display->userClipRect.width;
+	int y1 = display->userClipRect.y + display->userClipRect.height;
+
+	// only the rows of the current band are resident in the framebuffer
+	if(y0 < display->bandY) y0 = display->bandY;
+	if(y1 > display->bandY + display->bandRows) y1 = display->bandY + display->bandRows;
+
+	display->clipRect.x = x0;
+	display->clipRect.y = y0;
+	display->clipRect.width = (x1 > x0) ? (x1 - x0) : 0;
+	display->clipRect.height = (y1 > y0) ? (y1 - y0) : 0;
+}
+
+void lcdSetClipRect(int x, int y, int width, int height)
+{
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_SET_CLIP, 4, x, y, width, height);
+		return;
+	}
+
+	int x1 = x + width;
+	int y1 = y + height;
+
+	if(x < 0) x = 0;
+	if(y < 0) y = 0;
+	if(x1 > display->panel->width) x1 = display->panel->width;
+	if(y1 > display->panel->height) y1 = display->panel->height;
+
+	display->userClipRect.x = x;
+	display->userClipRect.y = y;
+	display->userClipRect.width = (x1 > x) ? (x1 - x) : 0;
+	display->userClipRect.height = (y1 > y) ? (y1 - y) : 0;
+
+	lcdUpdateClipRect();
+}
+
+void lcdResetClipRect()
+{
+	lcdSetClipRect(0, 0, display->panel->width, display->panel->height);
+}
+
+const LcdRect* lcdGetClipRect()
+{
+	return &display->clipRect;
+}
+
+void lcdStencilBegin(LcdStencil *stencil, int top)
+{
+	if(stencil == NULL || captureStencil) return;
+
+	for(uint16_t i = 0; i < stencil->capacity; i++)
+	{
+		stencil->spans[i].x0 = 0;
+		stencil->spans[i].x1 = 0;
+	}
+	stencil->top = top;
+
+	// the shape is captured now, not recorded
+	captureRecordTarget = lcdRecordTarget;
+	lcdRecordTarget = NULL;
+	captureStencil = stencil;
+}
+
+void lcdStencilEnd()
+{
+	if(captureStencil == NULL) return;
+
+	captureStencil = NULL;
+	lcdRecordTarget = captureRecordTarget;
+	captureRecordTarget = NULL;
+}
+
+void lcdSetStencil(const LcdStencil *stencil)
+{
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_SET_STENCIL, 2, (int)((uint32_t)(uintptr_t)stencil & 0xffff), (int)((uint32_t)(uintptr_t)stencil >> 16));
+		return;
+	}
+
+	display->stencil = stencil;
+}
+
+uint8_t lcdStencilClipRow(int y, int *x0, int *x1)
+{
+	const LcdStencil *stencil = display->stencil;
+
+	if(stencil)
+	{
+		unsigned row = (unsigned)(y - stencil->top);
+		if(row >= stencil->capacity) return 0;
+
+		if(*x0 < stencil->spans[row].x0) *x0 = stencil->spans[row].x0;
+		if(*x1 > stencil->spans[row].x1) *x1 = stencil->spans[row].x1;
+	}
+
+	return *x0 < *x1;
+}
+
+void lcdBeginRamWrite(int x, int y, int width, int height)
+{
+	if(lcdIsScanTransposed())
+	{
+		lcdSetWindowTransposed(x, y, width, height);
+	}
+	else
+	{
+		lcdSetWindow(x, y, width, height);
+	}
+	lcdCmd(LCD_CMD_RAMWR);
+	lcdSetSpiDataSize(SPI_DATASIZE_16BIT);
+	HAL_GPIO_WritePin(display->config.dcPort, display->config.dcPin, GPIO_PIN_SET);
+	HAL_GPIO_WritePin(display->config.csPort, display->config.csPin, GPIO_PIN_RESET);
+}
+
+static const uint8_t* lcdStreamFrameBuffer(void *context, uint8_t *scratch, uint32_t offset, uint32_t length)
+{
+	return (const uint8_t*)display->sending.pixels + offset;
+}
+
+static const uint8_t* lcdStreamFrameBufferRect(void *context, uint8_t *scratch, uint32_t offset, uint32_t length)
+{
+	uint16_t *pixels = (uint16_t*)scratch;
+	uint32_t index = offset / 2;
+	int x = index % display->sending.width;
+	const uint16_t *row = display->sending.pixels + (index / display->sending.width) * display->panel->width;
+
+	for(uint32_t i = 0; i < length / 2; i++)
+	{
+		pixels[i] = row[x];
+		if(++x == display->sending.width)
+		{
+			x = 0;
+			row += display->panel->width;
+		}
+	}
+
+	return scratch;
+}
+
+static const uint8_t* lcdStreamFrameBufferColumns(void *context, uint8_t *scratch, uint32_t offset, uint32_t length)
+{
+	uint16_t *pixels = (uint16_t*)scratch;
+	uint32_t index = offset / 2;
+	int x = index / display->sending.rows;
+	int y = index % display->sending.rows;
+
+	for(uint32_t i = 0; i < length / 2; i++)
+	{
+		pixels[i] = display->sending.pixels[x + y * display->panel->width];
+		if(++y == display->sending.rows)
+		{
+			y = 0;
+			x++;
+		}
+	}
+
+	return scratch;
+}
+
+/**
+ * @brief Describes the band currently drawn into.
+ */
+static void lcdCurrentBand(LcdBand *band)
+{
+	band->pixels = display->drawBuffer;
+	band->x = 0;
+	band->y = display->bandY;
+	band->width = display->panel->width;
+	band->rows = display->panel->height - display->bandY;
+	if(band->rows > display->bandRows)
+	{
+		band->rows = display->bandRows;
+	}
+}
+
+static void lcdStartTransfer()
+{
+	LcdBand band;
+	lcdCurrentBand(&band);
+
+	// narrow the band to the area requested by lcdCopyRect(), bands are always sent whole
+	LcdRect area = display->flushArea;
+	display->flushArea.width = 0;
+	if(area.width > 0 && !lcdIsBanded())
+	{
+		int x1 = area.x + area.width;
+		int y1 = area.y + area.height;
+		if(area.x < 0) area.x = 0;
+		if(area.y < band.y) area.y = band.y;
+		if(x1 > band.width) x1 = band.width;
+		if(y1 > band.y + band.rows) y1 = band.y + band.rows;
+		if(area.x >= x1 || area.y >= y1)
+		{
+			return;
+		}
+
+		band.pixels += area.x + (area.y - band.y) * display->panel->width;
+		band.x = area.x;
+		band.y = area.y;
+		band.width = x1 - area.x;
+		band.rows = y1 - area.y;
+	}
+
+	lcdTransferBand(&band);
+}
+
+static void lcdTransferBand(const LcdBand *band)
+{
+	display->sending = *band;
+	display->sendingRect = band->width != display->panel->width || (!lcdIsBanded() && band->rows != display->panel->height);
+	display->transferStartCycles = Perf_Now();
+
+	uint32_t bytes = (uint32_t)band->width * band->rows * display->panel->bytesPerPixel;
+	uint8_t contiguous = band->width == display->panel->width;
+	display->scanoutBytes = bytes;
+	display->scanoutStreamed = bytes / 2 > 0xffff || lcdIsScanTransposed() || !contiguous;
+	display->scanoutActive = 1;
+	if(display->raceTheBeam && !lcdIsBanded())
+	{
+		// bands are never drawn while being sent, see lcdNextBand()
+		display->scanoutSafeRow = band->y;
+	}
+
+	if(lcdIsScanTransposed())
+	{
+		// the controller expects the frame column by column, gather it on the fly
+		lcdStreamWindow(band->x, band->y, band->width, band->rows, lcdStreamFrameBufferColumns, NULL);
+		return;
+	}
+
+	if(!contiguous)
+	{
+		// rows of a rectangle are not adjacent in the framebuffer, gather them
+		lcdStreamWindow(band->x, band->y, band->width, band->rows, lcdStreamFrameBufferRect, NULL);
+		return;
+	}
+
+	if(bytes / 2 > 0xffff)
+	{
+		// does not fit the 16-bit DMA counter, stream it straight from the framebuffer
+		lcdStreamWindow(0, band->y, display->panel->width, band->rows, lcdStreamFrameBuffer, NULL);
+		return;
+	}
+
+	lcdBeginRamWrite(0, band->y, display->panel->width, band->rows);
+
+	display->spiBusy = 1;
+	if (HAL_OK != HAL_SPI_Transmit_DMA(display->config.spi, (uint8_t*)band->pixels, (uint16_t)(bytes / 2)))
+	{
+		HAL_GPIO_WritePin(display->config.csPort, display->config.csPin, GPIO_PIN_SET);
+		display->spiBusy = 0;
+		display->scanoutActive = 0;
+		display->scanoutSafeRow = INT_MAX;
+	}
+}
+
+/**
+ * @brief Sends the requested flush area, or keeps it pending until the
+ *        controller and the bus are ready.
+ */
+static void lcdFlush()
+{
+	if(display->initState != LCD_INIT_READY || display->spiBusy)
+	{
+		// sent by the init state machine or the transfer complete callback
+		display->flushPending = 1;
+		return;
+	}
+
+	display->flushPending = 0;
+
+	// an armed scroll step takes everything requested meanwhile along
+	if(display->presentMode == LCD_PRESENT_TE_SYNC || display->flushArmed)
+	{
+		// started by lcdHandleTearingEffect()
+		if(!display->flushArmed)
+		{
+			display->armCycles = Perf_Now();
+			display->flushArmed = 1;
+		}
+		return;
+	}
+
+	lcdStartTransfer();
+}
+
+/**
+ * @brief Adds a rectangle to the area sent by the next flush.
+ */
+static void lcdRequestFlushArea(int x, int y, int width, int height)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	LcdRect *area = &display->flushArea;
+	if(area->width > 0)
+	{
+		int x1 = area->x + area->width;
+		int y1 = area->y + area->height;
+		if(x + width > x1) x1 = x + width;
+		if(y + height > y1) y1 = y + height;
+		if(x > area->x) x = area->x;
+		if(y > area->y) y = area->y;
+		width = x1 - x;
+		height = y1 - y;
+	}
+	area->x = x;
+	area->y = y;
+	area->width = width;
+	area->height = height;
+	__set_PRIMASK(primask);
+}
+
+void lcdCopy()
+{
+	lcdRequestFlushArea(0, 0, display->panel->width, display->panel->height);
+	lcdFlush();
+}
 
-static void lcdCmd(uint8_t cmd)
+void lcdCopyRect(int x, int y, int width, int height)
 {
-	HAL_GPIO_WritePin(LCD_DC_GPIO_Port,LCD_DC_Pin, GPIO_PIN_RESET);
-	HAL_GPIO_WritePin(LCD_CS_GPIO_Port,LCD_CS_Pin, GPIO_PIN_RESET);
-	HAL_SPI_Transmit(&hspi2, &cmd, 1, HAL_MAX_DELAY);
-	HAL_GPIO_WritePin(LCD_CS_GPIO_Port,LCD_CS_Pin, GPIO_PIN_SET);
+	if(width <= 0 || height <= 0) return;
+
+	if(lcdIsBanded())
+	{
+		lcdCopy();
+		return;
+	}
+
+	lcdRequestFlushArea(x, y, width, height);
+	lcdFlush();
 }
 
-static void lcdData(uint8_t data)
+/**
+ * @brief Blocks until an armed flush has been started by a tearing effect event.
+ */
+static void lcdWaitForVsync()
 {
-	HAL_GPIO_WritePin(LCD_DC_GPIO_Port,LCD_DC_Pin, GPIO_PIN_SET);
-	HAL_GPIO_WritePin(LCD_CS_GPIO_Port,LCD_CS_Pin, GPIO_PIN_RESET);
-	HAL_SPI_Transmit(&hspi2, &data, 1, HAL_MAX_DELAY);
-	HAL_GPIO_WritePin(LCD_CS_GPIO_Port,LCD_CS_Pin, GPIO_PIN_SET);
+	while(display->flushArmed)
+	{
+		lcdCheckVsyncTimeout();
+		if(!display->flushArmed)
+		{
+			break;
+		}
+
+		if(__get_IPSR() == 0U)
+		{
+			lcdProcess();
+		}
+		else if(display->teSource == LCD_TE_SOURCE_SOFTWARE)
+		{
+			// the tick does not advance inside a handler, do not wait for it
+			lcdHandleTearingEffect();
+		}
+		else if(__HAL_GPIO_EXTI_GET_IT(display->config.tePin))
+		{
+			// same as in lcdWaitForTransfer(), serve the TE interrupt by hand
+			HAL_GPIO_EXTI_IRQHandler(display->config.tePin);
+		}
+	}
 }
 
-static void lcdSend(uint16_t value)
+static void lcdApplyPresentMode()
 {
-	if(value & 0x100)
+	uint8_t madctl = display->panel->madctl;
+	display->teForced = 0;
+	display->teSkip = 0;
+
+	if(display->presentMode == LCD_PRESENT_TE_SYNC)
 	{
-		lcdCmd(value);
-	} else
+		// follow the gate scan, see lcdIsScanTransposed()
+		madctl &= ~LCD_MADCTL_MV;
+		lcdCmd(LCD_CMD_TEON);
+		lcdData(0x00); // V-blanking information only
+	}
+	else
 	{
-		lcdData(value);
+		lcdCmd(LCD_CMD_TEOFF);
 	}
+
+	lcdCmd(LCD_CMD_MADCTL);
+	lcdData(madctl);
 }
 
-static void lcdData16(uint16_t value)
+/**
+ * @brief Sends the partial area in scan lines, see lcdSetPartialMode().
+ */
+static void lcdApplyPartialArea()
 {
-	lcdData(value >> 8);
-	lcdData(value);
+	const LcdPanel *panel = display->panel;
+
+	if(display->partialCount == 0)
+	{
+		lcdCmd(LCD_CMD_NORON);
+		return;
+	}
+
+	// the gate lines are screen columns on panels with exchanged rows and columns
+	uint8_t exchanged = panel->madctl & LCD_MADCTL_MV;
+	int lines = exchanged ? panel->width : panel->height;
+	int offset = exchanged ? panel->offsetX : panel->offsetY;
+	int first = display->partialFirst;
+
+	if(panel->madctl & LCD_MADCTL_MY)
+	{
+		first = lines - first - display->partialCount;
+	}
+
+	lcdCmd(LCD_CMD_PTLAR);
+	lcdData16(offset + first);
+	lcdData16(offset + first + display->partialCount - 1);
+	lcdCmd(LCD_CMD_PTLON);
 }
 
-static void lcdSetWindow(int x, int y, int width, int height)
+/**
+ * @brief Sends the scroll area and start line, see lcdSetScrollOffset().
+ */
+static void lcdApplyScroll()
 {
-	lcdCmd(ST7735S_CASET);
-	lcdData16(LCD_OFFSET_X + x);
-	lcdData16(LCD_OFFSET_X +  x + width - 1);
-
-	lcdCmd(ST7735S_RASET);
-	lcdData16(LCD_OFFSET_Y + y);
-	lcdData16(LCD_OFFSET_Y + y + height -1);
-}
-
-static const uint16_t initTable[] = {
-		 CMD(ST7735S_FRMCTR1), 0x01, 0x2c, 0x2d,
-		 CMD(ST7735S_FRMCTR2), 0x01, 0x2c, 0x2d,
-		 CMD(ST7735S_FRMCTR3), 0x01, 0x2c, 0x2d, 0x01, 0x2c, 0x2d,
-		 CMD(ST7735S_INVCTR), 0x07,
-		 CMD(ST7735S_PWCTR1), 0xa2, 0x02, 0x84,
-		 CMD(ST7735S_PWCTR2), 0xc5,
-		 CMD(ST7735S_PWCTR3), 0x0a, 0x00,
-		 CMD(ST7735S_PWCTR4), 0x8a, 0x2a,
-	     CMD(ST7735S_PWCTR5), 0x8a, 0xee,
-		 CMD(ST7735S_VMCTR1), 0x0e,
-		 CMD(ST7735S_GAMCTRP1), 0x0f, 0x1a, 0x0f, 0x18, 0x2f, 0x28, 0x20, 0x22,
-		                         0x1f, 0x1b, 0x23, 0x37, 0x00, 0x07, 0x02, 0x10,
-		 CMD(ST7735S_GAMCTRN1), 0x0f, 0x1b, 0x0f, 0x17, 0x33, 0x2c, 0x29, 0x2e,
-		                         0x30, 0x30, 0x39, 0x3f, 0x00, 0x07, 0x03, 0x10,
-		 CMD(0xf0), 0x01,
-		 CMD(0xf6), 0x00,
-		 CMD(ST7735S_COLMOD), 0x05,
-		 CMD(ST7735S_MADCTL), 0x60,
-};
+	const LcdPanel *panel = display->panel;
+	if(panel->scanLines == 0) return;
 
-static uint16_t frameBuffer[LCD_WIDTH * LCD_HEIGHT];
+	uint8_t exchanged = panel->madctl & LCD_MADCTL_MV;
+	int lines = exchanged ? panel->width : panel->height;
+	int offset = exchanged ? panel->offsetX : panel->offsetY;
+	int start = display->scrollOffset % lines;
 
-void lcdInit()
+	if(panel->madctl & LCD_MADCTL_MY)
+	{
+		// mirrored gate order, the picture has to move the other way
+		start = (lines - start) % lines;
+	}
+
+	// only the lines of the glass rotate, the RAM around them stays fixed
+	lcdCmd(LCD_CMD_VSCRDEF);
+	lcdData16(offset);
+	lcdData16(lines);
+	lcdData16(panel->scanLines - offset - lines);
+
+	lcdCmd(LCD_CMD_VSCSAD);
+	lcdData16(offset + start);
+
+	if(display->teForced && display->scrollOffset == 0)
+	{
+		// back in place, the events were only needed by lcdCopyRectAndScroll()
+		display->teForced = 0;
+		lcdCmd(LCD_CMD_TEOFF);
+	}
+}
+
+/**
+ * @brief Restores the power mode settings after the controller was reset.
+ */
+static void lcdApplyPowerMode()
 {
-	HAL_GPIO_WritePin(LCD_RST_GPIO_Port, LCD_RST_Pin, GPIO_PIN_RESET);
-	HAL_Delay(100);
-	HAL_GPIO_WritePin(LCD_RST_GPIO_Port, LCD_RST_Pin, GPIO_PIN_SET);
-	HAL_Delay(100);
+	if(display->frameRate != 0 && display->panel->setFrameRate != NULL)
+	{
+		display->panel->setFrameRate(display->panel, display->frameRate);
+	}
 
-	//send all init messages
-	for(int i=0; i < sizeof(initTable) / sizeof(uint16_t); i++)
+	lcdCmd(display->idleMode ? LCD_CMD_IDMON : LCD_CMD_IDMOFF);
+	lcdApplyPartialArea();
+	if(display->scrollOffset != 0)
 	{
-		lcdSend(initTable[i]);
+		lcdApplyScroll();
 	}
+}
+
+/**
+ * @brief Tells whether the controller registers may be written (init sequence sent, not in reset).
+ */
+static uint8_t lcdIsConfigured()
+{
+	return display->initState >= LCD_INIT_SLEEP_OUT_SETTLE;
+}
 
-	HAL_Delay(100);
+void lcdSetIdleMode(uint8_t enable)
+{
+	uint32_t start = Perf_Now();
 
-	lcdCmd(ST7735S_SLPOUT); // wake up
-	HAL_Delay(120);
+	display->idleMode = enable ? 1 : 0;
+	if(!lcdIsConfigured()) return;
 
-	lcdCmd(ST7735S_DISPON); // turn on display
+	// commands must not interleave with a running pixel transfer
+	lcdWaitForTransfer();
+	lcdCmd(display->idleMode ? LCD_CMD_IDMON : LCD_CMD_IDMOFF);
 
+	Perf_Record(display->idleMode ? &lcdPowerEnterPerf[LCD_POWER_IDLE] : &lcdPowerExitPerf[LCD_POWER_IDLE], start, 0);
 }
 
-void lcdFillPixel(int x, int y, uint16_t color)
+void lcdSetPartialMode(int first, int count)
 {
-	frameBuffer[x + y * LCD_WIDTH] = color;
+	uint32_t start = Perf_Now();
+	const LcdPanel *panel = display->panel;
+	int lines = (panel->madctl & LCD_MADCTL_MV) ? panel->width : panel->height;
+
+	if(first < 0) first = 0;
+	if(count < 0 || first >= lines) count = 0;
+	if(first + count > lines) count = lines - first;
+
+	display->partialFirst = first;
+	display->partialCount = count;
+	if(!lcdIsConfigured()) return;
+
+	lcdWaitForTransfer();
+	lcdApplyPartialArea();
+
+	Perf_Record(count ? &lcdPowerEnterPerf[LCD_POWER_PARTIAL] : &lcdPowerExitPerf[LCD_POWER_PARTIAL], start, count);
 }
 
-void lcdCopy()
+LcdScrollAxis lcdGetScrollAxis()
+{
+	if(display->panel->scanLines == 0) return LCD_SCROLL_NONE;
+	return (display->panel->madctl & LCD_MADCTL_MV) ? LCD_SCROLL_HORIZONTAL : LCD_SCROLL_VERTICAL;
+}
+
+uint8_t lcdSetScrollOffset(int offset)
+{
+	const LcdPanel *panel = display->panel;
+	if(panel->scanLines == 0) return 0;
+
+	int lines = (panel->madctl & LCD_MADCTL_MV) ? panel->width : panel->height;
+	offset %= lines;
+	if(offset < 0) offset += lines;
+
+	display->scrollOffset = offset;
+	if(!lcdIsConfigured()) return 1;
+
+	// the start line must not move before the strip written ahead of it has landed
+	lcdWaitForVsync();
+	lcdWaitForTransfer();
+	lcdApplyScroll();
+	return 1;
+}
+
+uint8_t lcdCopyRectAndScroll(int x, int y, int width, int height, int offset)
+{
+	const LcdPanel *panel = display->panel;
+	if(panel->scanLines == 0) return 0;
+
+	uint8_t synced = display->presentMode == LCD_PRESENT_TE_SYNC || display->teConfigured;
+	if(!synced || display->initState != LCD_INIT_READY || lcdIsBanded() || width <= 0 || height <= 0)
+	{
+		// no events to wait for (the TE line may not be wired), nothing on the
+		// glass yet, no strip, or bands far too long for the blanking
+		lcdCopyRect(x, y, width, height);
+		return lcdSetScrollOffset(offset);
+	}
+
+	int lines = (panel->madctl & LCD_MADCTL_MV) ? panel->width : panel->height;
+	offset %= lines;
+	if(offset < 0) offset += lines;
+
+	// the previous step has to be on the glass, the TE commands must not
+	// interleave with its pixels
+	lcdWaitForVsync();
+	lcdWaitForTransfer();
+
+	if(display->presentMode != LCD_PRESENT_TE_SYNC && display->teSource == LCD_TE_SOURCE_PIN && !display->teForced)
+	{
+		// on until the picture is back at offset 0, see lcdApplyScroll()
+		lcdCmd(LCD_CMD_TEON);
+		lcdData(0x00); // V-blanking information only
+		display->teForced = 1;
+		display->teSkip = 1;
+	}
+
+	display->scrollOffset = offset;
+	display->scrollArmed = 1;
+	lcdRequestFlushArea(x, y, width, height);
+	display->armCycles = Perf_Now();
+	display->flushArmed = 1;
+	return 1;
+}
+
+uint8_t lcdSetFrameRate(uint8_t hz)
+{
+	display->frameRate = hz;
+	if(!lcdIsConfigured() || display->panel->setFrameRate == NULL || hz == 0) return 0;
+
+	lcdWaitForTransfer();
+	return display->panel->setFrameRate(display->panel, hz);
+}
+
+void lcdSleep()
+{
+	if(display->initState != LCD_INIT_READY) return;
+
+	display->sleepCycles = Perf_Now();
+	lcdWaitForTransfer();
+
+	if(display->flushArmed)
+	{
+		// no tearing effect events while sleeping, send it after the wake up
+		display->flushArmed = 0;
+		display->flushPending = 1;
+	}
+
+	lcdCmd(LCD_CMD_SLPIN);
+	display->initTimestamp = HAL_GetTick();
+	display->initState = LCD_INIT_SLEEP_IN;
+}
+
+void lcdWake()
+{
+	if(display->initState != LCD_INIT_SLEEP_IN && display->initState != LCD_INIT_SLEEPING) return;
+
+	// SLPOUT is sent by lcdProcess() once SLPIN has settled
+	display->wakeCycles = Perf_Now();
+	display->wakeRequested = 1;
+}
+
+uint8_t lcdIsSleeping()
+{
+	return display->initState >= LCD_INIT_SLEEP_IN;
+}
+
+void lcdSetPresentMode(LcdPresentMode mode)
+{
+	lcdWaitForTransfer();
+
+	if(display->flushArmed)
+	{
+		display->flushArmed = 0;
+		display->flushPending = 1;
+	}
+
+	display->presentMode = mode;
+	if(lcdIsConfigured())
+	{
+		lcdApplyPresentMode();
+	}
+
+	if(display->flushPending && display->initState == LCD_INIT_READY)
+	{
+		lcdFlush();
+	}
+}
+
+LcdPresentMode lcdGetPresentMode()
+{
+	return display->presentMode;
+}
+
+void lcdSetTearingEffectSource(LcdTeSource source, uint32_t periodMs)
+{
+	display->tePeriodMs = periodMs;
+	display->teTimestamp = HAL_GetTick();
+	display->teSource = source;
+	display->teConfigured = 1;
+}
+
+/**
+ * @brief Sends an armed flush that waited too long for its tearing effect event.
+ * @details The scroll offset of lcdCopyRectAndScroll() follows from the
+ * transfer complete interrupt, commands must not interleave with the pixels.
+ */
+static void lcdCheckVsyncTimeout()
+{
+	if(!display->flushArmed) return;
+	if(Perf_Now() - display->armCycles < (SystemCoreClock / 1000U) * LCD_VSYNC_TIMEOUT_MS) return;
+
+	// the TE interrupt and the UI interrupts must not start a transfer meanwhile
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(display->flushArmed && !display->spiBusy)
+	{
+		display->flushArmed = 0;
+		display->teSkip = 0;
+		if(display->flushArea.width > 0)
+		{
+			lcdStartTransfer();
+		}
+		else if(display->scrollArmed)
+		{
+			display->scrollArmed = 0;
+			lcdApplyScroll();
+		}
+	}
+	__set_PRIMASK(primask);
+}
+
+static void lcdHandleTearingEffect()
+{
+	if(!display->flushArmed || display->spiBusy) return;
+	if(display->teSkip > 0)
+	{
+		display->teSkip--;
+		return;
+	}
+
+	display->flushArmed = 0;
+	Perf_Record(&lcdVsyncWaitPerf, display->armCycles, 1);
+	lcdStartTransfer();
+}
+
+void lcdWaitForTransfer()
+{
+	while(display->spiBusy)
+	{
+		if(__get_IPSR() != 0U)
+		{
+			// interrupts do not preempt each other in this project, so when
+			// called from a handler the DMA interrupt has to be served by hand
+			HAL_DMA_IRQHandler(display->config.spi->hdmatx);
+		}
+	}
+}
+
+void lcdBeginFrame()
+{
+	display->frameStartCycles = Perf_Now();
+	display->frameTimed = 1;
+	display->frameDropped = 0;
+
+	if(lcdIsBanded() && !lcdIsReady())
+	{
+		// asleep or coming up, no band could be sent
+		display->frameDropped = 1;
+		display->frameTimed = 0;
+	}
+	else if(lcdIsBanded())
+	{
+		// the band buffer is reused, the previous frame must be fully sent
+		lcdWaitForTransfer();
+		display->bandY = 0;
+		display->drawBuffer = display->config.frameBuffer;
+		lcdUpdateClipRect();
+	}
+
+	display->renderStartCycles = Perf_Now();
+}
+
+/**
+ * @brief Sends the current band, or queues it for the transfer complete
+ *        interrupt when the previous band is still being sent.
+ */
+static void lcdQueueBand()
+{
+	LcdBand band;
+	lcdCurrentBand(&band);
+
+	// decided in the critical section, once it ends the transfer complete
+	// interrupt may take the queued band and clear bandQueued
+	uint8_t queued = 0;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(display->spiBusy)
+	{
+		display->queued = band;
+		display->bandQueued = 1;
+		queued = 1;
+	}
+	__set_PRIMASK(primask);
+
+	if(!queued)
+	{
+		lcdTransferBand(&band);
+	}
+}
+
+/**
+ * @brief Blocks until no transfer reads the given half of the framebuffer.
+ */
+static void lcdWaitForBuffer(const uint16_t *pixels)
+{
+	while(display->spiBusy && display->sending.pixels == pixels)
+	{
+		if(__get_IPSR() != 0U)
+		{
+			// see lcdWaitForTransfer()
+			HAL_DMA_IRQHandler(display->config.spi->hdmatx);
+		}
+	}
+}
+
+uint8_t lcdNextBand()
+{
+	Perf_Record(&lcdBandRenderPerf, display->renderStartCycles, display->bandRows);
+
+	if(!lcdIsBanded())
+	{
+		lcdCopy();
+		return 0;
+	}
+
+	if(!lcdIsReady())
+	{
+		// bands cannot be kept pending and waiting for the bring-up or the
+		// wake up may hang a handler (the tick does not advance), drop the frame
+		display->frameDropped = 1;
+		display->frameTimed = 0;
+		display->bandY = 0;
+		display->drawBuffer = display->config.frameBuffer;
+		lcdUpdateClipRect();
+		return 0;
+	}
+
+	if(display->bandY == 0 && display->presentMode == LCD_PRESENT_TE_SYNC)
+	{
+		// only the first band can be synchronized, the rest follows as fast as it is drawn
+		lcdWaitForTransfer();
+		lcdCopy();
+		lcdWaitForVsync();
+	}
+	else if(display->pipelined)
+	{
+		lcdQueueBand();
+	}
+	else
+	{
+		lcdWaitForTransfer();
+		lcdStartTransfer();
+	}
+
+	if(display->bandY + display->bandRows >= display->panel->height)
+	{
+		return 0;
+	}
+
+	uint32_t stallStart = Perf_Now();
+	if(display->pipelined)
+	{
+		// draw the next band into the other half while this one is sent
+		display->drawBuffer = (display->drawBuffer == display->config.frameBuffer) ? display->config.frameBuffer + display->bandRows * display->panel->width : display->config.frameBuffer;
+		lcdWaitForBuffer(display->drawBuffer);
+	}
+	else
+	{
+		lcdWaitForTransfer();
+	}
+	Perf_Record(&lcdBandStallPerf, stallStart, 0);
+
+	display->bandY += display->bandRows;
+	lcdUpdateClipRect();
+	display->renderStartCycles = Perf_Now();
+	return 1;
+}
+
+uint8_t lcdIsFrameDropped()
+{
+	return display->frameDropped;
+}
+
+static void lcdHandleTransferComplete()
 {
-	lcdSetWindow(0, 0, LCD_WIDTH, LCD_HEIGHT);
-	lcdCmd(ST7735S_RAMWR);
-	HAL_GPIO_WritePin(LCD_DC_GPIO_Port, LCD_DC_Pin, GPIO_PIN_SET);
-	HAL_GPIO_WritePin(LCD_CS_GPIO_Port, LCD_CS_Pin, GPIO_PIN_RESET);
+	if(lcdStreamTransferComplete())
+	{
+		return;
+	}
+
+	HAL_GPIO_WritePin(display->config.csPort, display->config.csPin, GPIO_PIN_SET);
+	display->spiBusy = 0;
+
+	if(display->scanoutActive)
+	{
+		display->scanoutActive = 0;
+		display->scanoutSafeRow = INT_MAX;
+		Perf_Record(&lcdBandTransferPerf, display->transferStartCycles, display->sending.rows);
+		if(display->sendingRect)
+		{
+			Perf_Record(&lcdRectTransferPerf, display->transferStartCycles, display->sending.width * display->sending.rows);
+		}
+
+		if(display->frameTimed && display->sending.y + display->sending.rows >= display->panel->height)
+		{
+			display->frameTimed = 0;
+			Perf_Record(&lcdFramePerf, display->frameStartCycles, 0);
+		}
+	}
+
+	if(display->scrollArmed)
+	{
+		// the strip has landed, the start line follows in the same blanking
+		display->scrollArmed = 0;
+		lcdApplyScroll();
+	}
+
+	if(display->bandQueued)
+	{
+		// swap buffers, the band drawn meanwhile goes out right away
+		display->bandQueued = 0;
+		lcdTransferBand(&display->queued);
+		return;
+	}
+
+	if(display->flushPending && display->initState == LCD_INIT_READY)
+	{
+		lcdFlush();
+	}
+}
 
-	lcdSpiBusy = 1;
-	if (HAL_OK != HAL_SPI_Transmit_DMA(&hspi2, (uint8_t*)frameBuffer, (uint16_t)(LCD_WIDTH * LCD_HEIGHT*2)))
+void lcdTransferCompleteCallback(SPI_HandleTypeDef *hspi)
+{
+	for(uint8_t i = 0; i < displayCount; i++)
 	{
-		HAL_GPIO_WritePin(LCD_CS_GPIO_Port, LCD_CS_Pin, GPIO_PIN_SET);
-		lcdSpiBusy = 0;
+		if(displays[i].config.spi == hspi)
+		{
+			// interrupts do not nest, the selection is restored before anything else runs
+			LcdDisplay *selected = lcdSelectDisplay(&displays[i]);
+			lcdHandleTransferComplete();
+			display = selected;
+			return;
+		}
 	}
+}
 
+void lcdTearingEffectCallback(uint16_t pin)
+{
+	for(uint8_t i = 0; i < displayCount; i++)
+	{
+		if(displays[i].config.tePin == pin)
+		{
+			LcdDisplay *selected = lcdSelectDisplay(&displays[i]);
+			lcdHandleTearingEffect();
+			display = selected;
+		}
+	}
 }
 
 void lcdFillBackground(uint16_t color)
 {
-	for (int y = 0; y < LCD_HEIGHT; y++)
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_FILL_BACKGROUND, 1, color);
+		return;
+	}
+
+	for (int y = display->clipRect.y; y < display->clipRect.y + display->clipRect.height; y++)
 	{
-	    for (int x = 0; x < LCD_WIDTH; x++)
+	    for (int x = display->clipRect.x; x < display->clipRect.x + display->clipRect.width; x++)
 	    {
 	      lcdFillPixel(x, y, color);
 	    }
@@ -158,6 +1595,12 @@ void lcdFillBackground(uint16_t color)
 
 void lcdDrawLine(int x0, int y0, int x1, int y1, uint16_t color)
 {
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_DRAW_LINE, 5, x0, y0, x1, y1, color);
+		return;
+	}
+
 	int dx = abs(x1 - x0);
 	int sx = x0 < x1 ? 1 : -1;
 	int dy = -abs(y1 - y0);
@@ -187,6 +1630,12 @@ void lcdDrawLine(int x0, int y0, int x1, int y1, uint16_t color)
 
 void lcdDrawRectangle(int x, int y, int width, int height, uint16_t color)
 {
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_DRAW_RECTANGLE, 5, x, y, width, height, color);
+		return;
+	}
+
 	lcdDrawLine(x, y, x + width, y, color);
 	lcdDrawLine(x, y, x, y + height, color);
 	lcdDrawLine(x + width, y, x + width, y + height, color);
@@ -195,6 +1644,12 @@ void lcdDrawRectangle(int x, int y, int width, int height, uint16_t color)
 
 void lcdFillRectangle(int x, int y, int width, int height, uint16_t color)
 {
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_FILL_RECTANGLE, 5, x, y, width, height, color);
+		return;
+	}
+
 	for(int i=0; i < width; i++){
 		for(int j = 0; j < height; j++){
 			lcdFillPixel(x + i, y + j, color);
@@ -204,6 +1659,12 @@ void lcdFillRectangle(int x, int y, int width, int height, uint16_t color)
 
 void lcdDrawCircle(int x0, int y0, int radius, uint16_t color)
 {
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_DRAW_CIRCLE, 4, x0, y0, radius, color);
+		return;
+	}
+
 	// Bresenham algorithm
     int x = 0;
     int y = radius;
@@ -231,6 +1692,11 @@ void lcdDrawCircle(int x0, int y0, int radius, uint16_t color)
 }
 
 void lcdFillCircle(int x0, int y0, int radius, uint16_t color) {
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_FILL_CIRCLE, 4, x0, y0, radius, color);
+		return;
+	}
 
 	// Bresenham algorithm
     int x = 0;
@@ -257,6 +1723,12 @@ void lcdFillCircle(int x0, int y0, int radius, uint16_t color) {
 
 void lcdDrawRoundRectangle(int x0, int y0, int width, int height, int radius, uint16_t color)
 {
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_DRAW_ROUND_RECTANGLE, 6, x0, y0, width, height, radius, color);
+		return;
+	}
+
 
 	int correctedWidth = width - 1;
 	int correctedHeight = height - 1;
@@ -308,6 +1780,12 @@ void lcdDrawRoundRectangle(int x0, int y0, int width, int height, int radius, ui
 
 void lcdFillRoundRectangle(int x0, int y0, int width, int height, int radius, uint16_t color)
 {
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_FILL_ROUND_RECTANGLE, 6, x0, y0, width, height, radius, color);
+		return;
+	}
+
 	int correctedWidth = width - 1;
 	int correctedHeight = height - 1;
 
@@ -360,6 +1838,12 @@ static void lcdDrawChar(int x0, int y0, char c, uint16_t color, uint16_t bgColor
 
 void lcdDrawText(int x0, int y0, const char* str, uint16_t color, uint16_t bgColor)
 {
+	if(lcdRecordTarget)
+	{
+		lcdRecordText(x0, y0, str, color, bgColor);
+		return;
+	}
+
 	int x = x0;
 	int y = y0;
 
@@ -376,7 +1860,7 @@ void lcdDrawText(int x0, int y0, const char* str, uint16_t color, uint16_t bgCol
 			x += FONT_WIDTH + 1;
 		}
 
-		if(x + FONT_WIDTH >= LCD_WIDTH)
+		if(x + FONT_WIDTH >= display->panel->width)
 		{	// text wrapping if go beyond lcd width
 			y += FONT_HEIGHT + 2;
 			x = x0;
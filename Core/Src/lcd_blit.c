@@ -0,0 +1,242 @@
+/*
+ * lcd_blit.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ */
+#include <stddef.h>
+#include "lcd_blit.h"
+#include "lcd_internal.h"
+
+/** @brief Two pixels, may alias the uint16_t framebuffer. */
+typedef uint32_t __attribute__((may_alias)) LcdPixelPair;
+
+Perf_Counter lcdMoveRegionPerf;
+Perf_Counter lcdBlitPerf;
+
+/**
+ * @brief Copies pixels from the first to the last, safe when @p dst is below @p src.
+ */
+static void lcdCopyPixelsForward(uint16_t *dst, const uint16_t *src, int count)
+{
+	// word copies need both pointers on the same 4-byte boundary
+	if(((uintptr_t)dst & 2) == ((uintptr_t)src & 2))
+	{
+		if(((uintptr_t)dst & 2) && count > 0)
+		{
+			*dst++ = *src++;
+			count--;
+		}
+
+		LcdPixelPair *d = (LcdPixelPair*)dst;
+		const LcdPixelPair *s = (const LcdPixelPair*)src;
+		for(; count >= 8; count -= 8)
+		{
+			d[0] = s[0];
+			d[1] = s[1];
+			d[2] = s[2];
+			d[3] = s[3];
+			d += 4;
+			s += 4;
+		}
+		for(; count >= 2; count -= 2)
+		{
+			*d++ = *s++;
+		}
+
+		dst = (uint16_t*)d;
+		src = (const uint16_t*)s;
+	}
+
+	while(count-- > 0)
+	{
+		*dst++ = *src++;
+	}
+}
+
+/**
+ * @brief Copies pixels from the last to the first, safe when @p dst is above @p src.
+ */
+static void lcdCopyPixelsBackward(uint16_t *dst, const uint16_t *src, int count)
+{
+	dst += count;
+	src += count;
+
+	if(((uintptr_t)dst & 2) == ((uintptr_t)src & 2))
+	{
+		if(((uintptr_t)dst & 2) && count > 0)
+		{
+			*--dst = *--src;
+			count--;
+		}
+
+		LcdPixelPair *d = (LcdPixelPair*)dst;
+		const LcdPixelPair *s = (const LcdPixelPair*)src;
+		for(; count >= 8; count -= 8)
+		{
+			d -= 4;
+			s -= 4;
+			d[3] = s[3];
+			d[2] = s[2];
+			d[1] = s[1];
+			d[0] = s[0];
+		}
+		for(; count >= 2; count -= 2)
+		{
+			*--d = *--s;
+		}
+
+		dst = (uint16_t*)d;
+		src = (const uint16_t*)s;
+	}
+
+	while(count-- > 0)
+	{
+		*--dst = *--src;
+	}
+}
+
+void lcdMoveRegion(const LcdRect *src, int dx, int dy)
+{
+	if(src == NULL) return;
+
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_MOVE_REGION, 6, src->x, src->y, src->width, src->height, dx, dy);
+		return;
+	}
+
+	const LcdRect *clip = lcdGetClipRect();
+	int clipX1 = clip->x + clip->width;
+	int clipY1 = clip->y + clip->height;
+
+	// limit the source and the destination to the clip rectangle
+	int x0 = src->x;
+	int y0 = src->y;
+	int x1 = src->x + src->width;
+	int y1 = src->y + src->height;
+
+	if(x0 < clip->x) x0 = clip->x;
+	if(y0 < clip->y) y0 = clip->y;
+	if(x1 > clipX1) x1 = clipX1;
+	if(y1 > clipY1) y1 = clipY1;
+
+	if(x0 + dx < clip->x) x0 = clip->x - dx;
+	if(y0 + dy < clip->y) y0 = clip->y - dy;
+	if(x1 + dx > clipX1) x1 = clipX1 - dx;
+	if(y1 + dy > clipY1) y1 = clipY1 - dy;
+
+	int width = x1 - x0;
+	int height = y1 - y0;
+
+	if(width <= 0 || height <= 0 || (dx == 0 && dy == 0)) return;
+
+	uint32_t start = Perf_Now();
+	int stride = lcdGetWidth();
+	uint32_t pixels = 0;
+
+	// moving down, copy the bottom row first
+	int first = dy > 0 ? y1 - 1 : y0;
+	int step = dy > 0 ? -1 : 1;
+
+	for(int row = 0; row < height; row++)
+	{
+		int y = first + row * step;
+
+		// the stencil limits the destination pixels
+		int dstX0 = x0 + dx;
+		int dstX1 = x1 + dx;
+		if(!lcdStencilClipRow(y + dy, &dstX0, &dstX1)) continue;
+
+		uint16_t *dst = lcdFrameBufferRow(y + dy) + dstX0;
+		const uint16_t *from = dst - dy * stride - dx;
+
+		if(dy == 0 && dx > 0)
+		{
+			lcdCopyPixelsBackward(dst, from, dstX1 - dstX0);
+		}
+		else
+		{
+			lcdCopyPixelsForward(dst, from, dstX1 - dstX0);
+		}
+		pixels += dstX1 - dstX0;
+	}
+
+	Perf_Record(&lcdMoveRegionPerf, start, pixels);
+}
+
+void lcdDrawBitmap(const LcdBitmap *bitmap, int x, int y)
+{
+	if(bitmap == NULL) return;
+
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_DRAW_BITMAP, 4,
+				  (int)((uint32_t)(uintptr_t)bitmap & 0xffff), (int)((uint32_t)(uintptr_t)bitmap >> 16), x, y);
+		return;
+	}
+
+	const LcdRect *clip = lcdGetClipRect();
+	int x0 = x < clip->x ? clip->x : x;
+	int y0 = y < clip->y ? clip->y : y;
+	int x1 = x + bitmap->width;
+	int y1 = y + bitmap->height;
+	if(x1 > clip->x + clip->width) x1 = clip->x + clip->width;
+	if(y1 > clip->y + clip->height) y1 = clip->y + clip->height;
+
+	if(x0 >= x1 || y0 >= y1) return;
+
+	uint32_t start = Perf_Now();
+	uint32_t pixels = 0;
+
+	for(int row = y0; row < y1; row++)
+	{
+		int dstX0 = x0;
+		int dstX1 = x1;
+		if(!lcdStencilClipRow(row, &dstX0, &dstX1)) continue;
+
+		uint16_t *dst = lcdFrameBufferRow(row) + dstX0;
+		const uint16_t *src = bitmap->pixels + (row - y) * bitmap->width + (dstX0 - x);
+		int count = dstX1 - dstX0;
+
+		if(bitmap->useColorKey)
+		{
+			for(int i = 0; i < count; i++)
+			{
+				if(src[i] != bitmap->colorKey) dst[i] = src[i];
+			}
+		}
+		else
+		{
+			lcdCopyPixelsForward(dst, src, count);
+		}
+		pixels += count;
+	}
+
+	Perf_Record(&lcdBlitPerf, start, pixels);
+}
+
+void lcdReadRegion(const LcdRect *src, uint16_t *pixels)
+{
+	if(src == NULL || pixels == NULL) return;
+
+	const LcdRect *clip = lcdGetClipRect();
+	int x0 = src->x < clip->x ? clip->x : src->x;
+	int y0 = src->y < clip->y ? clip->y : src->y;
+	int x1 = src->x + src->width;
+	int y1 = src->y + src->height;
+	if(x1 > clip->x + clip->width) x1 = clip->x + clip->width;
+	if(y1 > clip->y + clip->height) y1 = clip->y + clip->height;
+
+	if(x0 >= x1 || y0 >= y1) return;
+
+	uint32_t start = Perf_Now();
+
+	for(int row = y0; row < y1; row++)
+	{
+		uint16_t *dst = pixels + (row - src->y) * src->width + (x0 - src->x);
+		lcdCopyPixelsForward(dst, lcdFrameBufferRow(row) + x0, x1 - x0);
+	}
+
+	Perf_Record(&lcdBlitPerf, start, (uint32_t)(x1 - x0) * (y1 - y0));
+}
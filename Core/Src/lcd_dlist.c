@@ -0,0 +1,376 @@
+/*
+ * lcd_dlist.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "lcd_dlist.h"
+#include "lcd_internal.h"
+#include "lcd_rotozoom.h"
+#include "lcd_blit.h"
+#include "lcd_gradient.h"
+#include "lcd_rle.h"
+#include "stm32f4xx_hal.h"
+
+// 32-bit FNV-1a
+#define FNV_OFFSET_BASIS	2166136261u
+#define FNV_PRIME			16777619u
+
+#define COMMAND_OPCODE(header)	((header) & 0xff)
+#define COMMAND_LENGTH(header)	((header) >> 8)
+
+LcdDisplayList *lcdRecordTarget = NULL;
+
+Perf_Counter lcdDisplayListPerf;
+
+// last presented frame of every display
+static struct {
+	uint8_t valid;
+	uint32_t hash;
+	uint16_t length;
+} presented[LCD_MAX_DISPLAYS];
+
+static const char * const opcodeNames[LCD_OP_COUNT] = {
+		"FILL_BACKGROUND",
+		"FILL_PIXEL",
+		"DRAW_LINE",
+		"DRAW_RECTANGLE",
+		"FILL_RECTANGLE",
+		"DRAW_CIRCLE",
+		"FILL_CIRCLE",
+		"DRAW_ROUND_RECTANGLE",
+		"FILL_ROUND_RECTANGLE",
+		"DRAW_TEXT",
+		"DRAW_TEXT_INLINE",
+		"SET_CLIP",
+		"DRAW_BITMAP_ROTOZOOM",
+		"MOVE_REGION",
+		"SET_STENCIL",
+		"FILL_LINEAR_GRADIENT",
+		"FILL_RADIAL_GRADIENT",
+		"DRAW_SHADOW",
+		"DRAW_BITMAP",
+		"DRAW_RLE_IMAGE",
+};
+
+/**
+ * @brief Appends a command header and reserves its parameters.
+ * @return Pointer to the parameter words, NULL if the list is full.
+ */
+static uint16_t* lcdRecordCommand(LcdOpcode op, int params)
+{
+	LcdDisplayList *list = lcdRecordTarget;
+	int words = params + 1;
+
+	if(list->overflow || words > 0xff || list->length + words > list->capacity)
+	{
+		list->overflow = 1;
+		return NULL;
+	}
+
+	uint16_t *command = &list->words[list->length];
+	command[0] = (uint16_t)(op | (words << 8));
+	list->length += words;
+	return command + 1;
+}
+
+void lcdRecord(LcdOpcode op, int count, ...)
+{
+	uint16_t *params = lcdRecordCommand(op, count);
+	if(params == NULL) return;
+
+	va_list args;
+	va_start(args, count);
+	for(int i = 0; i < count; i++)
+	{
+		params[i] = (uint16_t)va_arg(args, int);
+	}
+	va_end(args);
+}
+
+static uint8_t lcdIsInFlash(const void *ptr)
+{
+	return (uintptr_t)ptr >= FLASH_BASE && (uintptr_t)ptr <= FLASH_END;
+}
+
+void lcdRecordText(int x, int y, const char *str, uint16_t color, uint16_t bgColor)
+{
+	if(lcdIsInFlash(str))
+	{
+		lcdRecord(LCD_OP_DRAW_TEXT, 6, x, y, color, bgColor,
+				  (int)((uint32_t)(uintptr_t)str & 0xffff), (int)((uint32_t)(uintptr_t)str >> 16));
+		return;
+	}
+
+	// the buffer may change after recording, keep a copy of the characters
+	size_t length = strlen(str) + 1;
+	uint16_t *params = lcdRecordCommand(LCD_OP_DRAW_TEXT_INLINE, 4 + (length + 1) / 2);
+	if(params == NULL) return;
+
+	params[0] = x;
+	params[1] = y;
+	params[2] = color;
+	params[3] = bgColor;
+	params[4 + (length - 1) / 2] = 0; // padding byte, it is hashed
+	memcpy(&params[4], str, length);
+}
+
+static const void* lcdDecodePointer(const uint16_t *words)
+{
+	return (const void*)(uintptr_t)(words[0] | ((uint32_t)words[1] << 16));
+}
+
+void lcdDisplayListBegin(LcdDisplayList *list)
+{
+	if(list == NULL) return;
+
+	list->length = 0;
+	list->hash = 0;
+	list->overflow = 0;
+	lcdRecordTarget = list;
+}
+
+uint8_t lcdDisplayListEnd()
+{
+	LcdDisplayList *list = lcdRecordTarget;
+	lcdRecordTarget = NULL;
+
+	if(list == NULL) return 0;
+
+	uint32_t hash = FNV_OFFSET_BASIS;
+	for(uint16_t i = 0; i < list->length; i++)
+	{
+		hash = (hash ^ (list->words[i] & 0xff)) * FNV_PRIME;
+		hash = (hash ^ (list->words[i] >> 8)) * FNV_PRIME;
+	}
+	list->hash = hash;
+
+	return !list->overflow;
+}
+
+static void lcdSetReplayClip(int x, int y, int width, int height, const LcdRect *region)
+{
+	if(region != NULL)
+	{
+		int x1 = x + width;
+		int y1 = y + height;
+
+		if(x < region->x) x = region->x;
+		if(y < region->y) y = region->y;
+		if(x1 > region->x + region->width) x1 = region->x + region->width;
+		if(y1 > region->y + region->height) y1 = region->y + region->height;
+
+		width = x1 - x;
+		height = y1 - y;
+	}
+
+	lcdSetClipRect(x, y, width, height);
+}
+
+void lcdDisplayListReplay(const LcdDisplayList *list, const LcdRect *region)
+{
+	if(list == NULL || list->overflow) return;
+
+	lcdSetReplayClip(0, 0, lcdGetWidth(), lcdGetHeight(), region);
+
+	uint16_t i = 0;
+	while(i < list->length)
+	{
+		const uint16_t *command = &list->words[i];
+		const uint16_t *p = command + 1;
+		uint16_t length = COMMAND_LENGTH(command[0]);
+
+		if(length == 0) break;
+
+		// coordinates are stored as signed 16-bit values
+		#define ARG(n) ((int16_t)p[n])
+
+		switch(COMMAND_OPCODE(command[0]))
+		{
+		case LCD_OP_FILL_BACKGROUND:
+			lcdFillBackground(p[0]);
+			break;
+		case LCD_OP_FILL_PIXEL:
+			lcdFillPixel(ARG(0), ARG(1), p[2]);
+			break;
+		case LCD_OP_DRAW_LINE:
+			lcdDrawLine(ARG(0), ARG(1), ARG(2), ARG(3), p[4]);
+			break;
+		case LCD_OP_DRAW_RECTANGLE:
+			lcdDrawRectangle(ARG(0), ARG(1), ARG(2), ARG(3), p[4]);
+			break;
+		case LCD_OP_FILL_RECTANGLE:
+			lcdFillRectangle(ARG(0), ARG(1), ARG(2), ARG(3), p[4]);
+			break;
+		case LCD_OP_DRAW_CIRCLE:
+			lcdDrawCircle(ARG(0), ARG(1), ARG(2), p[3]);
+			break;
+		case LCD_OP_FILL_CIRCLE:
+			lcdFillCircle(ARG(0), ARG(1), ARG(2), p[3]);
+			break;
+		case LCD_OP_DRAW_ROUND_RECTANGLE:
+			lcdDrawRoundRectangle(ARG(0), ARG(1), ARG(2), ARG(3), ARG(4), p[5]);
+			break;
+		case LCD_OP_FILL_ROUND_RECTANGLE:
+			lcdFillRoundRectangle(ARG(0), ARG(1), ARG(2), ARG(3), ARG(4), p[5]);
+			break;
+		case LCD_OP_DRAW_TEXT:
+			lcdDrawText(ARG(0), ARG(1), lcdDecodePointer(&p[4]), p[2], p[3]);
+			break;
+		case LCD_OP_DRAW_TEXT_INLINE:
+			lcdDrawText(ARG(0), ARG(1), (const char*)&p[4], p[2], p[3]);
+			break;
+		case LCD_OP_SET_CLIP:
+			lcdSetReplayClip(ARG(0), ARG(1), ARG(2), ARG(3), region);
+			break;
+		case LCD_OP_DRAW_BITMAP_ROTOZOOM:
+			lcdDrawBitmapRotozoom(lcdDecodePointer(&p[0]), ARG(2), ARG(3), ARG(4), ARG(5), ARG(6),
+								  (int32_t)(p[7] | ((uint32_t)p[8] << 16)), p[9]);
+			break;
+		case LCD_OP_MOVE_REGION:
+		{
+			LcdRect src = { ARG(0), ARG(1), ARG(2), ARG(3) };
+			lcdMoveRegion(&src, ARG(4), ARG(5));
+			break;
+		}
+		case LCD_OP_SET_STENCIL:
+			lcdSetStencil(lcdDecodePointer(&p[0]));
+			break;
+		case LCD_OP_FILL_LINEAR_GRADIENT:
+			lcdFillLinearGradient(ARG(0), ARG(1), ARG(2), ARG(3), p[6], p[7], (LcdGradientDirection)p[4], p[5]);
+			break;
+		case LCD_OP_FILL_RADIAL_GRADIENT:
+			lcdFillRadialGradient(ARG(0), ARG(1), ARG(2), ARG(3), ARG(4), ARG(5), ARG(6), p[8], p[9], p[7]);
+			break;
+		case LCD_OP_DRAW_SHADOW:
+			lcdDrawShadow((LcdShadow*)lcdDecodePointer(&p[0]), ARG(2), ARG(3), ARG(4), ARG(5), p[6]);
+			break;
+		case LCD_OP_DRAW_BITMAP:
+			lcdDrawBitmap(lcdDecodePointer(&p[0]), ARG(2), ARG(3));
+			break;
+		case LCD_OP_DRAW_RLE_IMAGE:
+			lcdDrawRleImage(lcdDecodePointer(&p[0]), ARG(2), ARG(3));
+			break;
+		default:
+			break;
+		}
+
+		#undef ARG
+
+		i += length;
+	}
+
+	lcdResetClipRect();
+	lcdSetStencil(NULL);
+}
+
+uint8_t lcdDisplayListPresent(const LcdDisplayList *list)
+{
+	if(list == NULL || list->overflow) return 0;
+
+	uint32_t start = Perf_Now();
+	uint8_t index = lcdGetDisplayIndex();
+
+	if(presented[index].valid && presented[index].hash == list->hash && presented[index].length == list->length)
+	{
+		// the same frame is already on the screen
+		Perf_Record(&lcdDisplayListPerf, start, 0);
+		return 0;
+	}
+
+	lcdBeginFrame();
+	if(!lcdIsFrameDropped())
+	{
+		do
+		{
+			lcdDisplayListReplay(list, NULL);
+		} while(lcdNextBand());
+	}
+
+	if(lcdIsFrameDropped())
+	{
+		// not on the screen, the next present must draw it again
+		presented[index].valid = 0;
+		Perf_Record(&lcdDisplayListPerf, start, 0);
+		return 0;
+	}
+
+	presented[index].hash = list->hash;
+	presented[index].length = list->length;
+	presented[index].valid = 1;
+
+	Perf_Record(&lcdDisplayListPerf, start, 1);
+	return 1;
+}
+
+void lcdDisplayListInvalidate()
+{
+	presented[lcdGetDisplayIndex()].valid = 0;
+}
+
+void lcdDisplayListDump(const LcdDisplayList *list, void (*write)(const char *line))
+{
+	char line[96];
+
+	if(list == NULL || write == NULL) return;
+
+	snprintf(line, sizeof(line), "LIST %u words hash 0x%08lx%s", list->length,
+			 (unsigned long)list->hash, list->overflow ? " OVERFLOW" : "");
+	write(line);
+
+	uint16_t i = 0;
+	while(i < list->length)
+	{
+		const uint16_t *command = &list->words[i];
+		const uint16_t *p = command + 1;
+		uint16_t length = COMMAND_LENGTH(command[0]);
+		uint8_t op = COMMAND_OPCODE(command[0]);
+
+		if(length == 0 || op >= LCD_OP_COUNT) break;
+
+		int n = snprintf(line, sizeof(line), "%s", opcodeNames[op]);
+
+		switch(op)
+		{
+		case LCD_OP_DRAW_TEXT:
+		case LCD_OP_DRAW_TEXT_INLINE:
+			snprintf(line + n, sizeof(line) - n, " %d %d 0x%04x 0x%04x \"%s\"",
+					 (int16_t)p[0], (int16_t)p[1], p[2], p[3],
+					 op == LCD_OP_DRAW_TEXT ? (const char*)lcdDecodePointer(&p[4]) : (const char*)&p[4]);
+			break;
+		case LCD_OP_DRAW_BITMAP_ROTOZOOM:
+			snprintf(line + n, sizeof(line) - n, " %p %d %d %d %d %d 0x%08lx %u",
+					 lcdDecodePointer(&p[0]), (int16_t)p[2], (int16_t)p[3], (int16_t)p[4], (int16_t)p[5],
+					 (int16_t)p[6], (unsigned long)(p[7] | ((uint32_t)p[8] << 16)), p[9]);
+			break;
+		case LCD_OP_SET_STENCIL:
+			snprintf(line + n, sizeof(line) - n, " %p", lcdDecodePointer(&p[0]));
+			break;
+		case LCD_OP_DRAW_SHADOW:
+			snprintf(line + n, sizeof(line) - n, " %p %d %d %d %d 0x%04x", lcdDecodePointer(&p[0]),
+					 (int16_t)p[2], (int16_t)p[3], (int16_t)p[4], (int16_t)p[5], p[6]);
+			break;
+		case LCD_OP_DRAW_BITMAP:
+		case LCD_OP_DRAW_RLE_IMAGE:
+			snprintf(line + n, sizeof(line) - n, " %p %d %d", lcdDecodePointer(&p[0]), (int16_t)p[2], (int16_t)p[3]);
+			break;
+		default:
+			// plain coordinates, all drawing commands end with a color (gradients with two)
+			for(uint16_t k = 0; k + 1 < length && n < (int)sizeof(line); k++)
+			{
+				uint8_t isGradient = (op == LCD_OP_FILL_LINEAR_GRADIENT || op == LCD_OP_FILL_RADIAL_GRADIENT);
+				uint8_t isColor = (op != LCD_OP_SET_CLIP && op != LCD_OP_MOVE_REGION) &&
+								  (k + 2 == length || (isGradient && k + 3 == length));
+				n += snprintf(line + n, sizeof(line) - n, isColor ? " 0x%04x" : " %d",
+							  isColor ? p[k] : (int16_t)p[k]);
+			}
+			break;
+		}
+
+		write(line);
+		i += length;
+	}
+}
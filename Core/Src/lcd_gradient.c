@@ -0,0 +1,390 @@
+/*
+ * lcd_gradient.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ */
+#include <stddef.h>
+#include "lcd_gradient.h"
+#include "lcd_internal.h"
+
+#define FIX_SHIFT	16
+#define FIX_HALF	(1 << (FIX_SHIFT - 1))
+
+// shadow alpha is 5 bit to fit the packed RGB565 blend below
+#define ALPHA_BITS	5
+#define ALPHA_ONE	(1 << ALPHA_BITS)
+
+// RGB565 spread over 32 bits with gaps: ----GGGGGG-----RRRRR------BBBBB
+#define RGB565_SPREAD_MASK	0x07E0F81Fu
+
+// radial distances are tracked in 1/4 pixel
+#define RADIAL_SUBPIXELS	4
+
+Perf_Counter lcdGradientPerf[LCD_FILL_KIND_COUNT];
+
+// 4x4 Bayer matrix, thresholds 0..15
+static const uint8_t bayer[4][4] = {
+		{  0,  8,  2, 10 },
+		{ 12,  4, 14,  6 },
+		{  3, 11,  1,  9 },
+		{ 15,  7, 13,  5 },
+};
+
+/**
+ * @brief Color channels in 16.16 fixed point, in units of the RGB565 channel steps.
+ */
+typedef struct {
+	int32_t r;
+	int32_t g;
+	int32_t b;
+} Channels;
+
+static Channels toChannels(uint16_t color)
+{
+	Channels ch = {
+		(int32_t)((color >> 11) & 0x1f) << FIX_SHIFT,
+		(int32_t)((color >> 5) & 0x3f) << FIX_SHIFT,
+		(int32_t)(color & 0x1f) << FIX_SHIFT,
+	};
+	return ch;
+}
+
+/**
+ * @brief Per step increment going from @p from to @p to in @p steps steps.
+ * @details Truncated towards zero, so the last step never overshoots @p to.
+ */
+static Channels channelStep(const Channels *from, const Channels *to, int steps)
+{
+	Channels step = { 0, 0, 0 };
+	if(steps > 0)
+	{
+		step.r = (to->r - from->r) / steps;
+		step.g = (to->g - from->g) / steps;
+		step.b = (to->b - from->b) / steps;
+	}
+	return step;
+}
+
+/**
+ * @brief Quantizes channels to a framebuffer color.
+ * @param offset Rounding threshold in 16.16, FIX_HALF without dithering.
+ */
+static inline uint16_t toColor(int32_t r, int32_t g, int32_t b, int32_t offset)
+{
+	return (uint16_t)((((r + offset) >> FIX_SHIFT) << 11) |
+					  (((g + offset) >> FIX_SHIFT) << 5) |
+					  ((b + offset) >> FIX_SHIFT));
+}
+
+/**
+ * @brief Rounding thresholds of the row, indexed by x & 3.
+ */
+static void rowOffsets(int y, uint8_t dither, int32_t offsets[4])
+{
+	for(int i = 0; i < 4; i++)
+	{
+		// threshold in the middle of its 1/16 interval keeps the average color
+		offsets[i] = dither ? (2 * bayer[y & 3][i] + 1) << (FIX_SHIFT - 5) : FIX_HALF;
+	}
+}
+
+/**
+ * @brief Intersects a rectangle with the clip rectangle.
+ * @retval 0 if nothing is left.
+ */
+static uint8_t clipArea(int *x0, int *y0, int *x1, int *y1)
+{
+	const LcdRect *clip = lcdGetClipRect();
+
+	if(*x0 < clip->x) *x0 = clip->x;
+	if(*y0 < clip->y) *y0 = clip->y;
+	if(*x1 > clip->x + clip->width) *x1 = clip->x + clip->width;
+	if(*y1 > clip->y + clip->height) *y1 = clip->y + clip->height;
+
+	return *x0 < *x1 && *y0 < *y1;
+}
+
+static uint32_t isqrt(uint32_t value)
+{
+	uint32_t root = 0;
+	uint32_t bit = 1u << 30;
+
+	while(bit > value) bit >>= 2;
+
+	while(bit)
+	{
+		if(value >= root + bit)
+		{
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+static inline uint32_t spread565(uint16_t color)
+{
+	return (color | ((uint32_t)color << 16)) & RGB565_SPREAD_MASK;
+}
+
+static inline uint16_t pack565(uint32_t c)
+{
+	c &= RGB565_SPREAD_MASK;
+	return (uint16_t)(c | (c >> 16));
+}
+
+void lcdFillLinearGradient(int x, int y, int width, int height, uint16_t from, uint16_t to,
+						   LcdGradientDirection direction, uint8_t dither)
+{
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_FILL_LINEAR_GRADIENT, 8, x, y, width, height, direction, dither, from, to);
+		return;
+	}
+
+	int x0 = x, y0 = y, x1 = x + width, y1 = y + height;
+	if(!clipArea(&x0, &y0, &x1, &y1)) return;
+
+	uint32_t start = Perf_Now();
+	uint32_t pixels = 0;
+
+	const Channels first = toChannels(from);
+	const Channels last = toChannels(to);
+	const Channels step = channelStep(&first, &last, (direction == LCD_GRADIENT_VERTICAL ? height : width) - 1);
+
+	for(int row = y0; row < y1; row++)
+	{
+		int spanX0 = x0;
+		int spanX1 = x1;
+		if(!lcdStencilClipRow(row, &spanX0, &spanX1)) continue;
+
+		uint16_t *dst = lcdFrameBufferRow(row);
+		int32_t offsets[4];
+		rowOffsets(row, dither, offsets);
+
+		if(direction == LCD_GRADIENT_VERTICAL)
+		{
+			// constant color along the row, only the dither pattern repeats
+			int n = row - y;
+			int32_t r = first.r + n * step.r;
+			int32_t g = first.g + n * step.g;
+			int32_t b = first.b + n * step.b;
+			uint16_t pattern[4];
+
+			for(int i = 0; i < 4; i++)
+			{
+				pattern[i] = toColor(r, g, b, offsets[i]);
+			}
+			for(int col = spanX0; col < spanX1; col++)
+			{
+				dst[col] = pattern[col & 3];
+			}
+		}
+		else
+		{
+			int n = spanX0 - x;
+			int32_t r = first.r + n * step.r;
+			int32_t g = first.g + n * step.g;
+			int32_t b = first.b + n * step.b;
+
+			for(int col = spanX0; col < spanX1; col++, r += step.r, g += step.g, b += step.b)
+			{
+				dst[col] = toColor(r, g, b, offsets[col & 3]);
+			}
+		}
+
+		pixels += spanX1 - spanX0;
+	}
+
+	Perf_Record(&lcdGradientPerf[LCD_FILL_LINEAR], start, pixels);
+}
+
+void lcdFillRadialGradient(int x, int y, int width, int height, int cx, int cy, int radius,
+						   uint16_t inner, uint16_t outer, uint8_t dither)
+{
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_FILL_RADIAL_GRADIENT, 10, x, y, width, height, cx, cy, radius, dither, inner, outer);
+		return;
+	}
+
+	if(radius <= 0) return;
+
+	int x0 = x, y0 = y, x1 = x + width, y1 = y + height;
+	if(!clipArea(&x0, &y0, &x1, &y1)) return;
+
+	uint32_t start = Perf_Now();
+	uint32_t pixels = 0;
+
+	const int maxDistance = radius * RADIAL_SUBPIXELS;
+	const Channels first = toChannels(inner);
+	const Channels last = toChannels(outer);
+	const Channels step = channelStep(&first, &last, maxDistance);
+
+	for(int row = y0; row < y1; row++)
+	{
+		int spanX0 = x0;
+		int spanX1 = x1;
+		if(!lcdStencilClipRow(row, &spanX0, &spanX1)) continue;
+
+		uint16_t *dst = lcdFrameBufferRow(row);
+		int32_t offsets[4];
+		rowOffsets(row, dither, offsets);
+
+		// squared distance in 1/16 pixel², the distance follows it with at most a few steps per pixel
+		int dx = spanX0 - cx;
+		int dy = row - cy;
+		uint32_t dist2 = (uint32_t)(dx * dx + dy * dy) * (RADIAL_SUBPIXELS * RADIAL_SUBPIXELS);
+		uint32_t dist = isqrt(dist2);
+
+		for(int col = spanX0; col < spanX1; col++)
+		{
+			while(dist * dist > dist2) dist--;
+			while((dist + 1) * (dist + 1) <= dist2) dist++;
+
+			int n = dist < (uint32_t)maxDistance ? (int)dist : maxDistance;
+			dst[col] = toColor(first.r + n * step.r, first.g + n * step.g, first.b + n * step.b, offsets[col & 3]);
+
+			// (dx + 1)² - dx²
+			dist2 += (uint32_t)(2 * dx + 1) * (RADIAL_SUBPIXELS * RADIAL_SUBPIXELS);
+			dx++;
+		}
+
+		pixels += spanX1 - spanX0;
+	}
+
+	Perf_Record(&lcdGradientPerf[LCD_FILL_RADIAL], start, pixels);
+}
+
+/**
+ * @brief Computes the corner quadrant of a shadow.
+ * @details The corner circle is centered on the inner corner of the
+ * quadrant. Alpha is full inside the rounded rectangle and falls off
+ * quadratically over the blur width outside of it.
+ */
+static void lcdShadowPrepare(LcdShadow *shadow)
+{
+	const int size = shadow->radius + shadow->blur;
+
+	for(int qy = 0; qy < size; qy++)
+	{
+		for(int qx = 0; qx < size; qx++)
+		{
+			// pixel center distance from the circle center, in 1/16 pixel
+			int dx = 2 * size - (2 * qx + 1);
+			int dy = 2 * size - (2 * qy + 1);
+			int dist = (int)isqrt((uint32_t)(dx * dx + dy * dy) * 64);
+			int outside = dist - 16 * shadow->radius;
+			uint32_t falloff; // 0..256
+
+			if(outside <= 0) falloff = 256;
+			else if(outside >= 16 * shadow->blur) falloff = 0;
+			else falloff = 256 - (uint32_t)outside * 256 / (16 * shadow->blur);
+
+			uint32_t alpha = (falloff * falloff >> 8) * shadow->opacity * ALPHA_ONE;
+			shadow->alpha[qy * size + qx] = (uint8_t)((alpha + 255 * 128) / (255 * 256));
+		}
+	}
+
+	shadow->ready = 1;
+}
+
+void lcdDrawShadow(LcdShadow *shadow, int x, int y, int width, int height, uint16_t color)
+{
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_DRAW_SHADOW, 7, (int)((uint32_t)(uintptr_t)shadow & 0xffff),
+				  (int)((uint32_t)(uintptr_t)shadow >> 16), x, y, width, height, color);
+		return;
+	}
+
+	if(shadow == NULL) return;
+
+	if(!shadow->ready)
+	{
+		lcdShadowPrepare(shadow);
+	}
+
+	const int size = shadow->radius + shadow->blur;
+	const int left = x - shadow->blur;
+	const int top = y - shadow->blur;
+	const int right = x + width + shadow->blur - 1;
+	const int bottom = y + height + shadow->blur - 1;
+
+	int x0 = left, y0 = top, x1 = right + 1, y1 = bottom + 1;
+	if(!clipArea(&x0, &y0, &x1, &y1)) return;
+
+	uint32_t start = Perf_Now();
+	uint32_t pixels = 0;
+	const uint32_t shadowColor = spread565(color);
+
+	for(int row = y0; row < y1; row++)
+	{
+		int spanX0 = x0;
+		int spanX1 = x1;
+		if(!lcdStencilClipRow(row, &spanX0, &spanX1)) continue;
+
+		// distance from the nearest edge selects the mask row, the middle reuses the last one
+		int qy = row - top;
+		if(bottom - row < qy) qy = bottom - row;
+		if(qy > size - 1) qy = size - 1;
+
+		const uint8_t *mask = &shadow->alpha[qy * size];
+		uint16_t *dst = lcdFrameBufferRow(row);
+
+		for(int col = spanX0; col < spanX1; col++)
+		{
+			int qx = col - left;
+			if(right - col < qx) qx = right - col;
+			if(qx > size - 1) qx = size - 1;
+
+			uint32_t alpha = mask[qx];
+			if(alpha == 0) continue;
+
+			if(alpha >= ALPHA_ONE)
+			{
+				dst[col] = color;
+			}
+			else
+			{
+				uint32_t background = spread565(dst[col]);
+				dst[col] = pack565((background * (ALPHA_ONE - alpha) + shadowColor * alpha) >> ALPHA_BITS);
+			}
+			pixels++;
+		}
+	}
+
+	Perf_Record(&lcdGradientPerf[LCD_FILL_SHADOW], start, pixels);
+}
+
+void lcdGradientBenchmark(int iterations)
+{
+	LCD_SHADOW(benchShadow, 8, 6, 160);
+	const LcdRect *clip = lcdGetClipRect();
+	const LcdRect area = *clip;
+
+	for(int i = 0; i < LCD_FILL_KIND_COUNT; i++)
+	{
+		Perf_Reset(&lcdGradientPerf[i]);
+	}
+
+	for(int i = 0; i < iterations; i++)
+	{
+		uint32_t start = Perf_Now();
+		lcdFillRectangle(area.x, area.y, area.width, area.height, BLUE);
+		Perf_Record(&lcdGradientPerf[LCD_FILL_SOLID], start, (uint32_t)area.width * area.height);
+
+		lcdFillLinearGradient(area.x, area.y, area.width, area.height, BLUE, CYAN, LCD_GRADIENT_VERTICAL, 1);
+		lcdFillLinearGradient(area.x, area.y, area.width, area.height, BLACK, WHITE, LCD_GRADIENT_HORIZONTAL, 1);
+		lcdFillRadialGradient(area.x, area.y, area.width, area.height, area.x + area.width / 2,
+							  area.y + area.height / 2, area.width / 2, WHITE, BLUE, 1);
+		lcdDrawShadow(&benchShadow, area.x + benchShadow.blur, area.y + benchShadow.blur,
+					  area.width - 2 * benchShadow.blur, area.height - 2 * benchShadow.blur, BLACK);
+	}
+}
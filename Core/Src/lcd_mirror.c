@@ -0,0 +1,370 @@
+/*
+ * lcd_mirror.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ */
+#include <stdio.h>
+#include <string.h>
+#include "lcd_mirror.h"
+#include "lcd_internal.h"
+#include "lcd_rle.h"
+
+#define LCD_MIRROR_FRAME_HEADER_BYTES	12
+#define LCD_MIRROR_RECT_HEADER_BYTES	8
+
+// tiles of a full framebuffer, with room for the partial tiles at the right and bottom edges
+#define LCD_MIRROR_MAX_TILES	(LCD_FRAMEBUFFER_PIXELS / (LCD_MIRROR_TILE * LCD_MIRROR_TILE) + 32)
+
+#define LCD_MIRROR_LINE_BYTES	32
+
+// 32-bit FNV-1a
+#define FNV_OFFSET_BASIS	2166136261u
+#define FNV_PRIME			16777619u
+
+/**
+ * @brief State of the frame being encoded.
+ */
+typedef struct {
+	volatile uint8_t active;    ///< A frame is being encoded.
+	uint8_t full;               ///< The frame holds the whole screen.
+	uint8_t sequence;           ///< Frame number, lets the viewer detect lost frames.
+	uint8_t headerSent;         ///< The frame header is in a transmit buffer.
+	uint8_t rectStarted;        ///< The header of the current rectangle is in a transmit buffer.
+	uint16_t rectCount;         ///< Number of rectangles in rects.
+	uint16_t rectIndex;         ///< Rectangle being encoded.
+	uint32_t pixel;             ///< Next pixel of the current rectangle, row by row.
+	uint32_t bytes;             ///< Bytes handed to the DMA so far.
+	uint32_t startCycles;       ///< Perf_Now() at the start of the frame.
+	LcdRect rects[LCD_MIRROR_MAX_TILES];
+} LcdMirrorFrame;
+
+Perf_Counter lcdMirrorPerf;
+
+static LcdMirrorFrame frame;
+
+static uint32_t tileHashes[LCD_MIRROR_MAX_TILES];
+static uint8_t tileHashesValid = 0;
+
+static uint8_t txBuffers[2][LCD_MIRROR_TX_BYTES];
+static uint8_t fillIndex = 0;
+static uint16_t fillLength = 0;
+static volatile uint8_t txBusy = 0;
+static volatile uint8_t txQueued = 0;
+static uint8_t queuedIndex;
+static uint16_t queuedLength;
+
+static volatile uint8_t screenshotRequested = 0;
+static volatile uint32_t periodMs = 0;
+static uint32_t lastFrameTick;
+
+static uint8_t rxByte;
+static char rxLine[LCD_MIRROR_LINE_BYTES];
+static uint8_t rxIndex = 0;
+
+void lcdMirrorStart()
+{
+	HAL_UART_Receive_IT(&huart2, &rxByte, 1);
+}
+
+void lcdMirrorScreenshot()
+{
+	screenshotRequested = 1;
+}
+
+void lcdMirrorSetPeriod(uint32_t newPeriodMs)
+{
+	periodMs = newPeriodMs;
+	lastFrameTick = HAL_GetTick() - newPeriodMs;
+}
+
+/**
+ * @brief Executes a received command line, see the lcd_mirror.h file comment.
+ */
+static void lcdMirrorCommand(const char *line)
+{
+	unsigned long period;
+
+	if(strcmp(line, "SHOT") == 0)
+	{
+		lcdMirrorScreenshot();
+	}
+	else if(sscanf(line, "MIRROR %lu", &period) == 1)
+	{
+		lcdMirrorSetPeriod(period);
+	}
+}
+
+void lcdMirrorReceiveCallback(UART_HandleTypeDef *huart)
+{
+	if(huart != &huart2) return;
+
+	if(rxByte == '\n' || rxByte == '\r' || rxIndex >= LCD_MIRROR_LINE_BYTES - 1)
+	{
+		rxLine[rxIndex] = '\0';
+		if(rxIndex > 0)
+		{
+			lcdMirrorCommand(rxLine);
+		}
+		rxIndex = 0;
+	}
+	else
+	{
+		rxLine[rxIndex++] = rxByte;
+	}
+
+	HAL_UART_Receive_IT(&huart2, &rxByte, 1);
+}
+
+void lcdMirrorTransmitCompleteCallback(UART_HandleTypeDef *huart)
+{
+	if(huart != &huart2) return;
+
+	txBusy = 0;
+	if(txQueued)
+	{
+		txQueued = 0;
+		txBusy = 1;
+		HAL_UART_Transmit_DMA(&huart2, txBuffers[queuedIndex], queuedLength);
+	}
+}
+
+/**
+ * @brief Hands the filled transmit buffer to the DMA, or queues it behind the running transfer.
+ */
+static void lcdMirrorSubmit()
+{
+	if(fillLength == 0) return;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(txBusy)
+	{
+		queuedIndex = fillIndex;
+		queuedLength = fillLength;
+		txQueued = 1;
+	}
+	else
+	{
+		txBusy = 1;
+		HAL_UART_Transmit_DMA(&huart2, txBuffers[fillIndex], fillLength);
+	}
+	__set_PRIMASK(primask);
+
+	frame.bytes += fillLength;
+	fillIndex ^= 1;
+	fillLength = 0;
+}
+
+/**
+ * @brief Returns room for @p bytes in the transmit buffer being filled.
+ * @return Pointer to the free space, NULL while both buffers are in use.
+ *         The caller advances fillLength by the bytes actually written.
+ */
+static uint8_t* lcdMirrorReserve(uint16_t bytes)
+{
+	// while a buffer is queued the other one is being sent
+	if(txQueued) return NULL;
+
+	if(LCD_MIRROR_TX_BYTES - fillLength < bytes)
+	{
+		lcdMirrorSubmit();
+		if(txQueued) return NULL;
+	}
+
+	return &txBuffers[fillIndex][fillLength];
+}
+
+static uint8_t* lcdMirrorPut16(uint8_t *out, uint16_t value)
+{
+	out[0] = value & 0xff;
+	out[1] = value >> 8;
+	return out + 2;
+}
+
+static uint32_t lcdMirrorHashTile(const uint16_t *pixels, int stride, int x, int y, int width, int height)
+{
+	uint32_t hash = FNV_OFFSET_BASIS;
+
+	for(int row = y; row < y + height; row++)
+	{
+		const uint16_t *p = &pixels[row * stride + x];
+		for(int i = 0; i < width; i++)
+		{
+			hash = (hash ^ p[i]) * FNV_PRIME;
+		}
+	}
+	return hash;
+}
+
+/**
+ * @brief Adds a changed span of tiles, merged with an equal span of the tile row above.
+ */
+static void lcdMirrorAddRect(int x, int y, int width, int height, uint16_t previousRowStart)
+{
+	for(uint16_t i = previousRowStart; i < frame.rectCount; i++)
+	{
+		LcdRect *rect = &frame.rects[i];
+		if(rect->x == x && rect->width == width && rect->y + rect->height == y)
+		{
+			rect->height += height;
+			return;
+		}
+	}
+
+	frame.rects[frame.rectCount++] = (LcdRect){ x, y, width, height };
+}
+
+/**
+ * @brief Finds the changed areas of the framebuffer and starts a frame.
+ * @param full Send the whole screen regardless of the changes.
+ * @retval 1 if a frame was started, 0 if nothing has to be sent.
+ */
+static uint8_t lcdMirrorBeginFrame(uint8_t full)
+{
+	const uint16_t *pixels = lcdGetFrameBuffer();
+	int width = lcdGetWidth();
+	int height = lcdGetHeight();
+	int tilesX = (width + LCD_MIRROR_TILE - 1) / LCD_MIRROR_TILE;
+	int tilesY = (height + LCD_MIRROR_TILE - 1) / LCD_MIRROR_TILE;
+
+	if(pixels == NULL || tilesX * tilesY > LCD_MIRROR_MAX_TILES) return 0;
+
+	frame.startCycles = Perf_Now();
+	frame.full = full || !tileHashesValid;
+	frame.rectCount = 0;
+
+	uint16_t previousRowStart = 0;
+	for(int ty = 0; ty < tilesY; ty++)
+	{
+		int y = ty * LCD_MIRROR_TILE;
+		int tileHeight = (height - y < LCD_MIRROR_TILE) ? height - y : LCD_MIRROR_TILE;
+		uint16_t rowStart = frame.rectCount;
+		int spanStart = -1;
+
+		for(int tx = 0; tx <= tilesX; tx++)
+		{
+			uint8_t changed = 0;
+
+			if(tx < tilesX)
+			{
+				int x = tx * LCD_MIRROR_TILE;
+				int tileWidth = (width - x < LCD_MIRROR_TILE) ? width - x : LCD_MIRROR_TILE;
+				uint32_t hash = lcdMirrorHashTile(pixels, width, x, y, tileWidth, tileHeight);
+				uint32_t *stored = &tileHashes[ty * tilesX + tx];
+
+				changed = (hash != *stored);
+				*stored = hash;
+			}
+
+			if(changed && spanStart < 0)
+			{
+				spanStart = tx;
+			}
+			else if(!changed && spanStart >= 0)
+			{
+				int x = spanStart * LCD_MIRROR_TILE;
+				int spanEnd = (tx * LCD_MIRROR_TILE < width) ? tx * LCD_MIRROR_TILE : width;
+				lcdMirrorAddRect(x, y, spanEnd - x, tileHeight, previousRowStart);
+				spanStart = -1;
+			}
+		}
+
+		previousRowStart = rowStart;
+	}
+
+	tileHashesValid = 1;
+
+	if(frame.full)
+	{
+		frame.rects[0] = (LcdRect){ 0, 0, width, height };
+		frame.rectCount = 1;
+	}
+
+	if(frame.rectCount == 0) return 0;
+
+	frame.sequence++;
+	frame.headerSent = 0;
+	frame.rectStarted = 0;
+	frame.rectIndex = 0;
+	frame.pixel = 0;
+	frame.bytes = 0;
+	frame.active = 1;
+	return 1;
+}
+
+void lcdMirrorProcess()
+{
+	if(!frame.active)
+	{
+		uint8_t due = periodMs != 0 && HAL_GetTick() - lastFrameTick >= periodMs;
+		if(!screenshotRequested && !due) return;
+
+		uint8_t full = screenshotRequested;
+		screenshotRequested = 0;
+		lastFrameTick = HAL_GetTick();
+
+		if(!lcdMirrorBeginFrame(full)) return;
+	}
+
+	// banded since the frame was started, nothing left to read
+	const uint16_t *pixels = lcdGetFrameBuffer();
+	if(pixels == NULL)
+	{
+		frame.active = 0;
+		tileHashesValid = 0;
+		return;
+	}
+
+	while(frame.active)
+	{
+		uint8_t *out;
+
+		if(!frame.headerSent)
+		{
+			out = lcdMirrorReserve(LCD_MIRROR_FRAME_HEADER_BYTES);
+			if(out == NULL) return;
+
+			memcpy(out, "LCDM", 4);
+			out[4] = !frame.full;
+			out[5] = frame.sequence;
+			out = lcdMirrorPut16(out + 6, lcdGetWidth());
+			out = lcdMirrorPut16(out, lcdGetHeight());
+			lcdMirrorPut16(out, frame.rectCount);
+			fillLength += LCD_MIRROR_FRAME_HEADER_BYTES;
+			frame.headerSent = 1;
+		}
+
+		const LcdRect *rect = &frame.rects[frame.rectIndex];
+
+		if(!frame.rectStarted)
+		{
+			out = lcdMirrorReserve(LCD_MIRROR_RECT_HEADER_BYTES);
+			if(out == NULL) return;
+
+			out = lcdMirrorPut16(out, rect->x);
+			out = lcdMirrorPut16(out, rect->y);
+			out = lcdMirrorPut16(out, rect->width);
+			lcdMirrorPut16(out, rect->height);
+			fillLength += LCD_MIRROR_RECT_HEADER_BYTES;
+			frame.rectStarted = 1;
+		}
+
+		while(frame.pixel < (uint32_t)rect->width * rect->height)
+		{
+			out = lcdMirrorReserve(LCD_RLE_MAX_PACKET_BYTES);
+			if(out == NULL) return;
+
+			fillLength += lcdRleEncodePacket(pixels, lcdGetWidth(), rect, &frame.pixel, out);
+		}
+
+		frame.rectStarted = 0;
+		frame.pixel = 0;
+		if(++frame.rectIndex == frame.rectCount)
+		{
+			lcdMirrorSubmit();
+			Perf_Record(&lcdMirrorPerf, frame.startCycles, frame.bytes);
+			frame.active = 0;
+		}
+	}
+}
@@ -0,0 +1,259 @@
+/*
+ * lcd_panel.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ */
+#include <stdlib.h>
+#include "lcd_panel.h"
+#include "lcd_internal.h"
+
+#define ST7735S_FRMCTR1			0xb1
+#define ST7735S_FRMCTR2			0xb2
+#define ST7735S_FRMCTR3			0xb3
+#define ST7735S_INVCTR			0xb4
+#define ST7735S_PWCTR1			0xc0
+#define ST7735S_PWCTR2			0xc1
+#define ST7735S_PWCTR3			0xc2
+#define ST7735S_PWCTR4			0xc3
+#define ST7735S_PWCTR5			0xc4
+#define ST7735S_VMCTR1			0xc5
+#define ST7735S_GAMCTRP1		0xe0
+#define ST7735S_GAMCTRN1		0xe1
+
+#define ST7789_PORCTRL			0xb2
+#define ST7789_GCTRL			0xb7
+#define ST7789_VCOMS			0xbb
+#define ST7789_VDVVRHEN			0xc2
+#define ST7789_VRHS				0xc3
+#define ST7789_VDVS				0xc4
+#define ST7789_FRCTRL2			0xc6
+#define ST7789_PWCTRL1			0xd0
+
+#define ILI9341_PWCTR1			0xc0
+#define ILI9341_PWCTR2			0xc1
+#define ILI9341_VMCTR1			0xc5
+#define ILI9341_VMCTR2			0xc7
+#define ILI9341_FRMCTR1			0xb1
+#define ILI9341_FRMCTR2			0xb2
+#define ILI9341_FRMCTR3			0xb3
+#define ILI9341_DFUNCTR			0xb6
+#define ILI9341_GAMMASET		0x26
+#define ILI9341_GMCTRP1			0xe0
+#define ILI9341_GMCTRN1			0xe1
+
+#define TABLE_LENGTH(table) (sizeof(table) / sizeof(table[0]))
+
+// ST7735S frame rate = fosc / ((RTNA * 2 + 40) * (LINE + FPA + BPA + 2)),
+// the porches are kept as in st7735sInitTable
+#define ST7735S_FOSC_HZ			850000
+#define ST7735S_LINES			160
+#define ST7735S_FPA				0x2c
+#define ST7735S_BPA				0x2d
+#define ST7735S_RTNA_MAX		0x0f
+
+// RTNA of the ILI9341 FRMCTR1..3 registers for the first entry of ili9341FrameRates (DIVA = 0)
+#define ILI9341_RTNA_FIRST		0x10
+
+/** @brief ST7789 FRCTRL2 refresh rates in Hz, indexed by RTNA. */
+static const uint8_t st7789FrameRates[] = {
+		119, 111, 105, 99, 94, 90, 86, 82, 78, 75, 72, 69, 67, 64, 62, 60,
+		58, 57, 55, 53, 52, 50, 49, 48, 46, 45, 44, 43, 42, 41, 40, 39,
+};
+
+/** @brief ILI9341 FRMCTR1 refresh rates in Hz, indexed by RTNA - ILI9341_RTNA_FIRST. */
+static const uint8_t ili9341FrameRates[] = {
+		119, 112, 106, 100, 95, 90, 86, 83, 79, 76, 73, 70, 68, 65, 63, 61,
+};
+
+static uint8_t st7735sSetFrameRate(const LcdPanel *panel, uint8_t hz);
+static uint8_t st7789SetFrameRate(const LcdPanel *panel, uint8_t hz);
+static uint8_t ili9341SetFrameRate(const LcdPanel *panel, uint8_t hz);
+
+static const uint16_t st7735sInitTable[] = {
+		 CMD(ST7735S_FRMCTR1), 0x01, 0x2c, 0x2d,
+		 CMD(ST7735S_FRMCTR2), 0x01, 0x2c, 0x2d,
+		 CMD(ST7735S_FRMCTR3), 0x01, 0x2c, 0x2d, 0x01, 0x2c, 0x2d,
+		 CMD(ST7735S_INVCTR), 0x07,
+		 CMD(ST7735S_PWCTR1), 0xa2, 0x02, 0x84,
+		 CMD(ST7735S_PWCTR2), 0xc5,
+		 CMD(ST7735S_PWCTR3), 0x0a, 0x00,
+		 CMD(ST7735S_PWCTR4), 0x8a, 0x2a,
+	     CMD(ST7735S_PWCTR5), 0x8a, 0xee,
+		 CMD(ST7735S_VMCTR1), 0x0e,
+		 CMD(ST7735S_GAMCTRP1), 0x0f, 0x1a, 0x0f, 0x18, 0x2f, 0x28, 0x20, 0x22,
+		                         0x1f, 0x1b, 0x23, 0x37, 0x00, 0x07, 0x02, 0x10,
+		 CMD(ST7735S_GAMCTRN1), 0x0f, 0x1b, 0x0f, 0x17, 0x33, 0x2c, 0x29, 0x2e,
+		                         0x30, 0x30, 0x39, 0x3f, 0x00, 0x07, 0x03, 0x10,
+		 CMD(0xf0), 0x01,
+		 CMD(0xf6), 0x00,
+		 CMD(LCD_CMD_COLMOD), 0x05,
+};
+
+static const uint16_t st7789InitTable[] = {
+		 CMD(ST7789_PORCTRL), 0x0c, 0x0c, 0x00, 0x33, 0x33,
+		 CMD(ST7789_GCTRL), 0x35,
+		 CMD(ST7789_VCOMS), 0x19,
+		 CMD(ST7789_VDVVRHEN), 0x01,
+		 CMD(ST7789_VRHS), 0x12,
+		 CMD(ST7789_VDVS), 0x20,
+		 CMD(ST7789_FRCTRL2), 0x0f,
+		 CMD(ST7789_PWCTRL1), 0xa4, 0xa1,
+		 CMD(LCD_CMD_COLMOD), 0x55,
+		 CMD(LCD_CMD_INVON),
+		 CMD(LCD_CMD_NORON),
+};
+
+static const uint16_t ili9341InitTable[] = {
+		 CMD(ILI9341_PWCTR1), 0x23,
+		 CMD(ILI9341_PWCTR2), 0x10,
+		 CMD(ILI9341_VMCTR1), 0x3e, 0x28,
+		 CMD(ILI9341_VMCTR2), 0x86,
+		 CMD(LCD_CMD_COLMOD), 0x55,
+		 CMD(ILI9341_FRMCTR1), 0x00, 0x18,
+		 CMD(ILI9341_DFUNCTR), 0x08, 0x82, 0x27,
+		 CMD(ILI9341_GAMMASET), 0x01,
+		 CMD(ILI9341_GMCTRP1), 0x0f, 0x31, 0x2b, 0x0c, 0x0e, 0x08, 0x4e, 0xf1,
+		                        0x37, 0x07, 0x10, 0x03, 0x0e, 0x09, 0x00,
+		 CMD(ILI9341_GMCTRN1), 0x00, 0x0e, 0x14, 0x03, 0x11, 0x07, 0x31, 0xc1,
+		                        0x48, 0x08, 0x0f, 0x0c, 0x31, 0x36, 0x0f,
+		 CMD(LCD_CMD_NORON),
+};
+
+const LcdPanel lcdPanelST7735S = {
+		.name = "ST7735S 160x128",
+		.width = 160,
+		.height = 128,
+		.offsetX = 0,
+		.offsetY = 0,
+		.bytesPerPixel = 2,
+		.madctl = 0x60,
+		.scanLines = 162,
+		.initTable = st7735sInitTable,
+		.initTableLength = TABLE_LENGTH(st7735sInitTable),
+		.sendInitSequence = lcdPanelSendInitTable,
+		.setWindow = lcdPanelSetWindowDcs,
+		.setFrameRate = st7735sSetFrameRate,
+};
+
+const LcdPanel lcdPanelST7789 = {
+		.name = "ST7789 240x240",
+		.width = 240,
+		.height = 240,
+		.offsetX = 0,
+		.offsetY = 0,
+		.bytesPerPixel = 2,
+		.madctl = 0x00,
+		.scanLines = 320,
+		.initTable = st7789InitTable,
+		.initTableLength = TABLE_LENGTH(st7789InitTable),
+		.sendInitSequence = lcdPanelSendInitTable,
+		.setWindow = lcdPanelSetWindowDcs,
+		.setFrameRate = st7789SetFrameRate,
+};
+
+const LcdPanel lcdPanelILI9341 = {
+		.name = "ILI9341 320x240",
+		.width = 320,
+		.height = 240,
+		.offsetX = 0,
+		.offsetY = 0,
+		.bytesPerPixel = 2,
+		.madctl = 0x28,
+		.scanLines = 320,
+		.initTable = ili9341InitTable,
+		.initTableLength = TABLE_LENGTH(ili9341InitTable),
+		.sendInitSequence = lcdPanelSendInitTable,
+		.setWindow = lcdPanelSetWindowDcs,
+		.setFrameRate = ili9341SetFrameRate,
+};
+
+void lcdPanelSendInitTable(const LcdPanel *panel)
+{
+	//send all init messages
+	for(size_t i = 0; i < panel->initTableLength; i++)
+	{
+		lcdSend(panel->initTable[i]);
+	}
+}
+
+void lcdPanelSetWindowDcs(const LcdPanel *panel, int x, int y, int width, int height)
+{
+	lcdCmd(LCD_CMD_CASET);
+	lcdData16(panel->offsetX + x);
+	lcdData16(panel->offsetX + x + width - 1);
+
+	lcdCmd(LCD_CMD_RASET);
+	lcdData16(panel->offsetY + y);
+	lcdData16(panel->offsetY + y + height - 1);
+}
+
+/**
+ * @brief Finds the entry of a frame rate table closest to @p hz.
+ */
+static size_t lcdPanelClosestRate(const uint8_t *rates, size_t count, uint8_t hz)
+{
+	size_t best = 0;
+
+	for(size_t i = 1; i < count; i++)
+	{
+		if(abs(rates[i] - hz) < abs(rates[best] - hz))
+		{
+			best = i;
+		}
+	}
+	return best;
+}
+
+static uint8_t st7735sSetFrameRate(const LcdPanel *panel, uint8_t hz)
+{
+	uint8_t rtna = 0;
+	uint32_t rate = 0;
+
+	for(uint8_t i = 0; i <= ST7735S_RTNA_MAX; i++)
+	{
+		uint32_t candidate = ST7735S_FOSC_HZ / ((i * 2 + 40) * (ST7735S_LINES + ST7735S_FPA + ST7735S_BPA + 2));
+		if(i == 0 || abs((int)candidate - hz) < abs((int)rate - hz))
+		{
+			rtna = i;
+			rate = candidate;
+		}
+	}
+
+	// the same rate in normal, idle and partial mode
+	lcdCmd(ST7735S_FRMCTR1);
+	lcdData(rtna); lcdData(ST7735S_FPA); lcdData(ST7735S_BPA);
+	lcdCmd(ST7735S_FRMCTR2);
+	lcdData(rtna); lcdData(ST7735S_FPA); lcdData(ST7735S_BPA);
+	lcdCmd(ST7735S_FRMCTR3);
+	lcdData(rtna); lcdData(ST7735S_FPA); lcdData(ST7735S_BPA);
+	lcdData(rtna); lcdData(ST7735S_FPA); lcdData(ST7735S_BPA);
+
+	return (uint8_t)rate;
+}
+
+static uint8_t st7789SetFrameRate(const LcdPanel *panel, uint8_t hz)
+{
+	size_t rtna = lcdPanelClosestRate(st7789FrameRates, TABLE_LENGTH(st7789FrameRates), hz);
+
+	// normal mode only, idle and partial mode keep FRCTRL1 defaults
+	lcdCmd(ST7789_FRCTRL2);
+	lcdData(rtna);
+
+	return st7789FrameRates[rtna];
+}
+
+static uint8_t ili9341SetFrameRate(const LcdPanel *panel, uint8_t hz)
+{
+	size_t index = lcdPanelClosestRate(ili9341FrameRates, TABLE_LENGTH(ili9341FrameRates), hz);
+
+	// the same rate in normal, idle and partial mode
+	lcdCmd(ILI9341_FRMCTR1);
+	lcdData(0x00); lcdData(ILI9341_RTNA_FIRST + index);
+	lcdCmd(ILI9341_FRMCTR2);
+	lcdData(0x00); lcdData(ILI9341_RTNA_FIRST + index);
+	lcdCmd(ILI9341_FRMCTR3);
+	lcdData(0x00); lcdData(ILI9341_RTNA_FIRST + index);
+
+	return ili9341FrameRates[index];
+}
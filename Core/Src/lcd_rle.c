@@ -0,0 +1,176 @@
+/*
+ * lcd_rle.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ */
+#include <stddef.h>
+#include "lcd_rle.h"
+#include "lcd_internal.h"
+
+Perf_Counter lcdRleDecodePerf;
+
+static uint16_t lcdRlePixel(const uint16_t *pixels, int stride, const LcdRect *rect, uint32_t index)
+{
+	int x = rect->x + index % rect->width;
+	int y = rect->y + index / rect->width;
+	return pixels[y * stride + x];
+}
+
+uint16_t lcdRleEncodePacket(const uint16_t *pixels, int stride, const LcdRect *rect, uint32_t *index, uint8_t *out)
+{
+	uint32_t total = (uint32_t)rect->width * rect->height;
+	uint32_t first = *index;
+	uint16_t value = lcdRlePixel(pixels, stride, rect, first);
+	uint32_t run = 1;
+
+	while(first + run < total && run < LCD_RLE_MAX_REPEAT && lcdRlePixel(pixels, stride, rect, first + run) == value)
+	{
+		run++;
+	}
+
+	if(run >= 2)
+	{
+		out[0] = (uint8_t)(run + 126);
+		out[1] = value >> 8;
+		out[2] = value & 0xff;
+		*index += run;
+		return 3;
+	}
+
+	// literal pixels up to the next pair of equal ones
+	uint32_t count = 1;
+	uint16_t next = (first + 1 < total) ? lcdRlePixel(pixels, stride, rect, first + 1) : 0;
+	while(count < LCD_RLE_MAX_LITERAL && first + count < total)
+	{
+		uint16_t current = next;
+		next = (first + count + 1 < total) ? lcdRlePixel(pixels, stride, rect, first + count + 1) : ~current;
+		if(current == next) break;
+		count++;
+	}
+
+	out[0] = (uint8_t)(count - 1);
+	for(uint32_t i = 0; i < count; i++)
+	{
+		uint16_t pixel = lcdRlePixel(pixels, stride, rect, first + i);
+		out[1 + i * 2] = pixel >> 8;
+		out[2 + i * 2] = pixel & 0xff;
+	}
+	*index += count;
+	return 1 + count * 2;
+}
+
+uint32_t lcdRleEncode(const LcdRect *rect, uint8_t *out, uint32_t capacity)
+{
+	const uint16_t *pixels = lcdGetFrameBuffer();
+	if(pixels == NULL || rect->width <= 0 || rect->height <= 0) return 0;
+
+	uint32_t total = (uint32_t)rect->width * rect->height;
+	uint32_t index = 0;
+	uint32_t length = 0;
+	uint8_t packet[LCD_RLE_MAX_PACKET_BYTES];
+
+	while(index < total)
+	{
+		uint16_t bytes = lcdRleEncodePacket(pixels, lcdGetWidth(), rect, &index, packet);
+		if(length + bytes > capacity) return 0;
+
+		for(uint16_t i = 0; i < bytes; i++)
+		{
+			out[length + i] = packet[i];
+		}
+		length += bytes;
+	}
+
+	return length;
+}
+
+/**
+ * @brief Writes @p count decoded pixels of one image row to the framebuffer.
+ * @param data   Packet pixels, MSB first, the same pixel for all when @p repeat is set.
+ */
+static void lcdRleWriteRow(int x, int y, int count, const uint8_t *data, uint8_t repeat, const LcdRect *clip)
+{
+	if(y < clip->y) return;
+
+	int x0 = x < clip->x ? clip->x : x;
+	int x1 = x + count;
+	if(x1 > clip->x + clip->width) x1 = clip->x + clip->width;
+	if(x0 >= x1 || !lcdStencilClipRow(y, &x0, &x1)) return;
+
+	uint16_t *dst = lcdFrameBufferRow(y) + x0;
+	int n = x1 - x0;
+
+	if(repeat)
+	{
+		uint16_t value = ((uint16_t)data[0] << 8) | data[1];
+		while(n-- > 0)
+		{
+			*dst++ = value;
+		}
+	}
+	else
+	{
+		const uint8_t *src = data + (x0 - x) * 2;
+		while(n-- > 0)
+		{
+			*dst++ = ((uint16_t)src[0] << 8) | src[1];
+			src += 2;
+		}
+	}
+}
+
+void lcdDrawRleImage(const LcdRleImage *image, int x, int y)
+{
+	if(image == NULL) return;
+
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_DRAW_RLE_IMAGE, 4,
+				  (int)((uint32_t)(uintptr_t)image & 0xffff), (int)((uint32_t)(uintptr_t)image >> 16), x, y);
+		return;
+	}
+
+	const LcdRect *clip = lcdGetClipRect();
+	int rows = image->height;
+	if(y + rows > clip->y + clip->height)
+	{
+		// runs only go forward, nothing below the clip rectangle has to be parsed
+		rows = clip->y + clip->height - y;
+	}
+
+	uint32_t start = Perf_Now();
+	const uint8_t *p = image->data;
+	const uint8_t *end = image->data + image->size;
+	int col = 0;
+	int row = 0;
+
+	while(p < end && row < rows)
+	{
+		uint8_t header = *p++;
+		uint8_t repeat = header >= 128;
+		int count = repeat ? header - 126 : header + 1;
+		const uint8_t *data = p;
+		p += repeat ? 2 : count * 2;
+
+		// a packet may span several rows
+		while(count > 0 && row < rows)
+		{
+			int n = image->width - col;
+			if(n > count) n = count;
+
+			lcdRleWriteRow(x + col, y + row, n, data, repeat, clip);
+
+			if(!repeat) data += n * 2;
+			count -= n;
+			col += n;
+			if(col == image->width)
+			{
+				col = 0;
+				row++;
+			}
+		}
+	}
+
+	Perf_Record(&lcdRleDecodePerf, start, (uint32_t)row * image->width + col);
+}
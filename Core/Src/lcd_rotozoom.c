@@ -0,0 +1,183 @@
+/*
+ * lcd_rotozoom.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ */
+#include <stddef.h>
+#include "lcd_rotozoom.h"
+#include "lcd_internal.h"
+
+#define FIX_SHIFT	16
+#define FIX_HALF	(1 << (FIX_SHIFT - 1))
+
+// bilinear weights are 5 bit to fit the packed RGB565 blend below
+#define WEIGHT_BITS	5
+#define WEIGHT_ONE	(1 << WEIGHT_BITS)
+
+// RGB565 spread over 32 bits with gaps: ----GGGGGG-----RRRRR------BBBBB
+#define RGB565_SPREAD_MASK	0x07E0F81Fu
+
+Perf_Counter lcdRotozoomPerf[LCD_FILTER_COUNT];
+
+// sin(0..90 deg) in 16.16 fixed point
+static const int32_t sinTable[91] = {
+		0, 1144, 2287, 3430, 4572, 5712, 6850, 7987,
+		9121, 10252, 11380, 12505, 13626, 14742, 15855, 16962,
+		18064, 19161, 20252, 21336, 22415, 23486, 24550, 25607,
+		26656, 27697, 28729, 29753, 30767, 31772, 32768, 33754,
+		34729, 35693, 36647, 37590, 38521, 39441, 40348, 41243,
+		42126, 42995, 43852, 44695, 45525, 46341, 47143, 47930,
+		48703, 49461, 50203, 50931, 51643, 52339, 53020, 53684,
+		54332, 54963, 55578, 56175, 56756, 57319, 57865, 58393,
+		58903, 59396, 59870, 60326, 60764, 61183, 61584, 61966,
+		62328, 62672, 62997, 63303, 63589, 63856, 64104, 64332,
+		64540, 64729, 64898, 65048, 65177, 65287, 65376, 65446,
+		65496, 65526, 65536,
+};
+
+static int32_t fixSin(int deg)
+{
+	deg %= 360;
+	if(deg < 0) deg += 360;
+
+	if(deg <= 90) return sinTable[deg];
+	if(deg <= 180) return sinTable[180 - deg];
+	if(deg <= 270) return -sinTable[deg - 180];
+	return -sinTable[360 - deg];
+}
+
+static int32_t fixCos(int deg)
+{
+	return fixSin(deg + 90);
+}
+
+static inline uint32_t spread565(uint16_t color)
+{
+	return (color | ((uint32_t)color << 16)) & RGB565_SPREAD_MASK;
+}
+
+static inline uint16_t pack565(uint32_t c)
+{
+	c &= RGB565_SPREAD_MASK;
+	return (uint16_t)(c | (c >> 16));
+}
+
+static inline uint32_t lerpSpread(uint32_t a, uint32_t b, uint32_t w)
+{
+	return ((a * (WEIGHT_ONE - w) + b * w) >> WEIGHT_BITS) & RGB565_SPREAD_MASK;
+}
+
+void lcdDrawBitmapRotozoom(const LcdBitmap *bitmap,
+						   int dstX, int dstY, int dstWidth, int dstHeight,
+						   int angleDeg, int32_t scale, LcdFilter filter)
+{
+	if(bitmap == NULL || scale <= 0 || filter >= LCD_FILTER_COUNT) return;
+
+	if(lcdRecordTarget)
+	{
+		lcdRecord(LCD_OP_DRAW_BITMAP_ROTOZOOM, 10,
+				  (int)((uint32_t)(uintptr_t)bitmap & 0xffff), (int)((uint32_t)(uintptr_t)bitmap >> 16),
+				  dstX, dstY, dstWidth, dstHeight, angleDeg,
+				  (int)((uint32_t)scale & 0xffff), (int)((uint32_t)scale >> 16), filter);
+		return;
+	}
+
+	uint32_t start = Perf_Now();
+	uint32_t pixels = 0;
+
+	const int texW = bitmap->width;
+	const int texH = bitmap->height;
+	const int32_t s = fixSin(angleDeg);
+	const int32_t c = fixCos(angleDeg);
+
+	// inverse mapping: texture step per destination pixel is R(-angle) / scale
+	const int32_t duDx = (int32_t)(((int64_t)c << FIX_SHIFT) / scale);
+	const int32_t dvDx = (int32_t)(((int64_t)-s << FIX_SHIFT) / scale);
+	const int32_t duDy = -dvDx;
+	const int32_t dvDy = duDx;
+
+	// half extents of the rotated bitmap, used to skip empty rows and columns
+	const int32_t absS = s < 0 ? -s : s;
+	const int32_t absC = c < 0 ? -c : c;
+	int halfW = (int)((((int64_t)absC * texW + (int64_t)absS * texH) * scale) >> (2 * FIX_SHIFT + 1)) + 1;
+	int halfH = (int)((((int64_t)absS * texW + (int64_t)absC * texH) * scale) >> (2 * FIX_SHIFT + 1)) + 1;
+
+	const int centerX = dstX + dstWidth / 2;
+	const int centerY = dstY + dstHeight / 2;
+
+	// destination area = rotated bounds ∩ destination rectangle ∩ clip rectangle
+	const LcdRect *clip = lcdGetClipRect();
+	int x0 = centerX - halfW, x1 = centerX + halfW;
+	int y0 = centerY - halfH, y1 = centerY + halfH;
+	if(x0 < dstX) x0 = dstX;
+	if(y0 < dstY) y0 = dstY;
+	if(x1 > dstX + dstWidth) x1 = dstX + dstWidth;
+	if(y1 > dstY + dstHeight) y1 = dstY + dstHeight;
+	if(x0 < clip->x) x0 = clip->x;
+	if(y0 < clip->y) y0 = clip->y;
+	if(x1 > clip->x + clip->width) x1 = clip->x + clip->width;
+	if(y1 > clip->y + clip->height) y1 = clip->y + clip->height;
+	if(x0 >= x1 || y0 >= y1) return;
+
+	// texture coordinate of the first pixel center, relative offsets in 16.16
+	const int32_t relX = ((x0 - dstX) << FIX_SHIFT) + FIX_HALF - (dstWidth << (FIX_SHIFT - 1));
+	const int32_t relY = ((y0 - dstY) << FIX_SHIFT) + FIX_HALF - (dstHeight << (FIX_SHIFT - 1));
+	int32_t rowU = (texW << (FIX_SHIFT - 1)) + (int32_t)(((int64_t)duDx * relX + (int64_t)duDy * relY) >> FIX_SHIFT);
+	int32_t rowV = (texH << (FIX_SHIFT - 1)) + (int32_t)(((int64_t)dvDx * relX + (int64_t)dvDy * relY) >> FIX_SHIFT);
+
+	const uint16_t *tex = bitmap->pixels;
+	const uint8_t useKey = bitmap->useColorKey;
+	const uint16_t key = bitmap->colorKey;
+
+	for(int y = y0; y < y1; y++, rowU += duDy, rowV += dvDy)
+	{
+		int spanX0 = x0;
+		int spanX1 = x1;
+		if(!lcdStencilClipRow(y, &spanX0, &spanX1)) continue;
+
+		uint16_t *dst = lcdFrameBufferRow(y);
+		int32_t u = rowU + (spanX0 - x0) * duDx;
+		int32_t v = rowV + (spanX0 - x0) * dvDx;
+
+		for(int x = spanX0; x < spanX1; x++, u += duDx, v += dvDx)
+		{
+			int iu = u >> FIX_SHIFT;
+			int iv = v >> FIX_SHIFT;
+
+			if((unsigned)iu >= (unsigned)texW || (unsigned)iv >= (unsigned)texH) continue;
+
+			uint16_t texel = tex[iu + iv * texW];
+			if(useKey && texel == key) continue;
+
+			if(filter == LCD_FILTER_BILINEAR)
+			{
+				// sample positions are texel centers, hence the half texel shift
+				int32_t su = u - FIX_HALF;
+				int32_t sv = v - FIX_HALF;
+				int bu0 = su >> FIX_SHIFT;
+				int bv0 = sv >> FIX_SHIFT;
+				uint32_t wu = (su >> (FIX_SHIFT - WEIGHT_BITS)) & (WEIGHT_ONE - 1);
+				uint32_t wv = (sv >> (FIX_SHIFT - WEIGHT_BITS)) & (WEIGHT_ONE - 1);
+				int bu1 = bu0 + 1;
+				int bv1 = bv0 + 1;
+
+				if(bu0 < 0) bu0 = 0;
+				if(bv0 < 0) bv0 = 0;
+				if(bu1 >= texW) bu1 = texW - 1;
+				if(bv1 >= texH) bv1 = texH - 1;
+
+				const uint16_t *r0 = tex + bv0 * texW;
+				const uint16_t *r1 = tex + bv1 * texW;
+				uint32_t top = lerpSpread(spread565(r0[bu0]), spread565(r0[bu1]), wu);
+				uint32_t bottom = lerpSpread(spread565(r1[bu0]), spread565(r1[bu1]), wu);
+				texel = pack565(lerpSpread(top, bottom, wv));
+			}
+
+			dst[x] = texel;
+			pixels++;
+		}
+	}
+
+	Perf_Record(&lcdRotozoomPerf[filter], start, pixels);
+}
@@ -0,0 +1,450 @@
+/*
+ * lcd_stream.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  A stream of N bytes is split into D equal chunks sent in double-buffer
+ *  mode, followed by a tail sent with normal DMA transfers:
+ *
+ *    | chunk 0 | chunk 1 | ... | chunk D-1 | tail |
+ *
+ *  The double-buffer mode is circular, when the last chunk completes the
+ *  DMA has already started on the other buffer. That buffer is loaded with
+ *  the beginning of the tail, so whatever the DMA sent before it is stopped
+ *  is valid data. The tail is kept at least half a chunk long to leave the
+ *  interrupt enough time to stop the DMA before the loaded data runs out.
+ *
+ *  The interrupts do not nest and the UI draws from handlers, so the buffer
+ *  switch interrupt may come too late: the DMA has then gone on into a
+ *  buffer that was not refilled, or past the end of the tail. Every switch
+ *  checks where the DMA is. A late switch reports the wrong buffer, and
+ *  the DMA cannot have got further than the SPI clock allows since the last
+ *  check. When stale data may have been sent, the window is sent again from
+ *  its first byte, so the result never depends on the interrupt latency.
+ *
+ *  Pixels are sent as 16-bit SPI frames (see lcdBeginRamWrite()), lengths
+ *  are kept in bytes here and halved where they are handed to the DMA.
+ */
+#include <stddef.h>
+#include "lcd_stream.h"
+#include "lcd_internal.h"
+
+/**
+ * @brief State of the running stream.
+ */
+typedef struct {
+	LcdStreamFill fill;       ///< Data source.
+	void *context;            ///< User pointer for the data source.
+	uint32_t total;           ///< Length of the stream in bytes.
+	uint32_t chunks;          ///< Number of chunks sent in double-buffer mode (0 or >= 2).
+	uint32_t chunksDone;      ///< Chunks already sent in double-buffer mode.
+	uint32_t nextChunk;       ///< Next chunk to be loaded into an idle buffer.
+	const uint8_t *tailData;  ///< Start of the tail, loaded after the last chunk.
+	uint32_t tailLength;      ///< Number of valid bytes at tailData.
+	const uint8_t *pending;   ///< Data still to be sent before offset.
+	uint32_t pendingLength;   ///< Number of bytes at pending.
+	uint32_t offset;          ///< Next byte to request from the data source.
+	uint32_t transferStart;   ///< Stream offset of the running normal transfer.
+	uint32_t transferLength;  ///< Length of the running normal transfer.
+	uint32_t startCycles;     ///< Perf_Now() at the stream start.
+	uint8_t scratchIndex;     ///< Scratch buffer used by the next normal transfer.
+	int x;                    ///< Window top-left X coordinate, kept for a restart.
+	int y;                    ///< Window top-left Y coordinate.
+	int width;                ///< Window width in pixels.
+	int height;               ///< Window height in pixels.
+	uint32_t cyclesPerByte;   ///< CPU cycles the SPI needs at least for one byte.
+	uint32_t checkCycles;     ///< Perf_Now() at the last position check.
+	uint32_t checkPosition;   ///< Stream offset of the DMA at the last position check.
+	volatile uint8_t active;  ///< Non-zero while the stream owns the bus.
+	LcdDisplay *display;      ///< Display the stream is sent to.
+	SPI_HandleTypeDef *spi;   ///< Bus of that display.
+	uint16_t fillColor;       ///< Color of lcdStreamFillRect().
+	uint16_t filledColor;     ///< Color the scratch buffers listed in filledBuffers hold.
+	uint8_t *filledBuffers[2];
+	uint8_t scratch[2][LCD_STREAM_CHUNK_BYTES] __attribute__((aligned(4)));
+} LcdStream;
+
+/** @brief Bytes the DMA may run ahead of the SPI (data and shift register, no FIFO). */
+#define LCD_STREAM_DMA_AHEAD	4
+
+/** @brief Position check result of a DMA that may have sent stale data. */
+#define LCD_STREAM_OVERRUN		UINT32_MAX
+
+Perf_Counter lcdStreamPerf;
+uint32_t lcdStreamRestarts;
+
+// one stream per display, displays on different buses stream concurrently
+static LcdStream streams[LCD_MAX_DISPLAYS];
+
+static LcdStream* lcdSelectedStream()
+{
+	return &streams[lcdGetDisplayIndex()];
+}
+
+static LcdStream* lcdFindStream(DMA_HandleTypeDef *hdma)
+{
+	for(int i = 0; i < LCD_MAX_DISPLAYS; i++)
+	{
+		if(streams[i].active && streams[i].spi->hdmatx == hdma)
+		{
+			return &streams[i];
+		}
+	}
+	return NULL;
+}
+
+static const uint8_t* lcdStreamFillSolid(void *context, uint8_t *buffer, uint32_t offset, uint32_t length);
+
+static void lcdStreamEnd(LcdStream *stream)
+{
+	stream->active = 0;
+	Perf_Record(&lcdStreamPerf, stream->startCycles, stream->total);
+}
+
+static uint8_t lcdStreamSendNext(LcdStream *stream)
+{
+	const uint8_t *data;
+	uint32_t length;
+
+	if(stream->pendingLength > 0)
+	{
+		data = stream->pending;
+		length = stream->pendingLength;
+		stream->transferStart = stream->offset - length;
+		stream->pendingLength = 0;
+	}
+	else if(stream->offset < stream->total)
+	{
+		length = stream->total - stream->offset;
+		if(length > LCD_STREAM_CHUNK_BYTES)
+		{
+			length = LCD_STREAM_CHUNK_BYTES;
+		}
+
+		data = stream->fill(stream->context, stream->scratch[stream->scratchIndex], stream->offset, length);
+		stream->scratchIndex ^= 1;
+		stream->transferStart = stream->offset;
+		stream->offset += length;
+	}
+	else
+	{
+		return 0;
+	}
+
+	stream->transferLength = length;
+
+	return HAL_OK == HAL_SPI_Transmit_DMA(stream->spi, (uint8_t*)data, (uint16_t)(length / 2));
+}
+
+/**
+ * @brief Ends the stream and releases the bus of its display.
+ */
+static void lcdStreamFinish(LcdStream *stream)
+{
+	lcdStreamEnd(stream);
+	lcdTransferCompleteCallback(stream->spi);
+}
+
+static void lcdStreamAbort(LcdStream *stream)
+{
+	HAL_DMA_Abort(stream->spi->hdmatx);
+	CLEAR_BIT(stream->spi->Instance->CR2, SPI_CR2_TXDMAEN);
+	lcdStreamFinish(stream);
+}
+
+/**
+ * @brief CPU cycles the SPI needs at least for one byte.
+ */
+static uint32_t lcdStreamCyclesPerByte(SPI_HandleTypeDef *spi)
+{
+	uint32_t pclk = (spi->Instance == SPI2 || spi->Instance == SPI3) ? HAL_RCC_GetPCLK1Freq() : HAL_RCC_GetPCLK2Freq();
+	uint32_t divider = 2U << ((spi->Instance->CR1 & SPI_CR1_BR) >> SPI_CR1_BR_Pos);
+	uint32_t cycles = (uint32_t)(8ULL * SystemCoreClock * divider / pclk);
+	return cycles > 0 ? cycles : 1;
+}
+
+/**
+ * @brief Locates the DMA after the switch away from @p buffer.
+ * @details Only one switch may have happened since the last check: the one
+ * reported must be the expected buffer (the buffers alternate starting with
+ * MEMORY0) and the time elapsed must be too short for the DMA to finish the
+ * buffer it is in now.
+ * @return Stream offset of the DMA, LCD_STREAM_OVERRUN if it may have gone
+ *         into a buffer that was not refilled.
+ */
+static uint32_t lcdStreamCheckPosition(LcdStream *stream, HAL_DMA_MemoryTypeDef buffer)
+{
+	uint32_t now = Perf_Now();
+	uint32_t remaining = stream->spi->hdmatx->Instance->NDTR * 2;
+	uint32_t bufferStart = stream->chunksDone * LCD_STREAM_CHUNK_BYTES;
+
+	if(buffer != ((stream->chunksDone & 1) ? MEMORY0 : MEMORY1)) return LCD_STREAM_OVERRUN;
+
+	uint32_t reachable = stream->checkPosition + (now - stream->checkCycles) / stream->cyclesPerByte + LCD_STREAM_DMA_AHEAD;
+	if(reachable >= bufferStart + LCD_STREAM_CHUNK_BYTES) return LCD_STREAM_OVERRUN;
+
+	stream->checkCycles = now;
+	stream->checkPosition = bufferStart + LCD_STREAM_CHUNK_BYTES - remaining;
+	return stream->checkPosition;
+}
+
+static void lcdStreamStart(LcdStream *stream);
+
+/**
+ * @brief Sends the whole window again, the DMA may have sent stale data.
+ */
+static void lcdStreamRestart(LcdStream *stream)
+{
+	SPI_HandleTypeDef *spi = stream->spi;
+
+	HAL_DMA_Abort(spi->hdmatx);
+	CLEAR_BIT(spi->Instance->CR2, SPI_CR2_TXDMAEN);
+	lcdStreamRestarts++;
+
+	// the panel must receive whole frames before the window address
+	while(!__HAL_SPI_GET_FLAG(spi, SPI_FLAG_TXE) || __HAL_SPI_GET_FLAG(spi, SPI_FLAG_BSY))
+	{
+	}
+
+	LcdDisplay *selected = lcdSelectDisplay(stream->display);
+	lcdStreamStart(stream);
+	lcdSelectDisplay(selected);
+}
+
+static void lcdStreamBufferDone(DMA_HandleTypeDef *hdma, HAL_DMA_MemoryTypeDef buffer)
+{
+	LcdStream *stream = lcdFindStream(hdma);
+	if(stream == NULL) return;
+
+	if(++stream->chunksDone == stream->chunks)
+	{
+		// the DMA has moved on to the buffer holding the start of the tail
+		HAL_DMA_Abort(hdma);
+		CLEAR_BIT(stream->spi->Instance->CR2, SPI_CR2_TXDMAEN);
+
+		uint32_t position = lcdStreamCheckPosition(stream, buffer);
+		uint32_t consumed = position - stream->chunks * LCD_STREAM_CHUNK_BYTES;
+		if(position == LCD_STREAM_OVERRUN || consumed > stream->tailLength)
+		{
+			// sent past the end of the tail
+			lcdStreamRestart(stream);
+			return;
+		}
+
+		stream->pending = stream->tailData + consumed;
+		stream->pendingLength = stream->tailLength - consumed;
+
+		if(!lcdStreamSendNext(stream))
+		{
+			lcdStreamFinish(stream);
+		}
+		return;
+	}
+
+	if(lcdStreamCheckPosition(stream, buffer) == LCD_STREAM_OVERRUN)
+	{
+		lcdStreamRestart(stream);
+		return;
+	}
+
+	const uint8_t *data;
+	uint8_t *idle = stream->scratch[buffer == MEMORY0 ? 0 : 1];
+
+	// the data sources read the state of the display they stream from
+	LcdDisplay *selected = lcdSelectDisplay(stream->display);
+
+	if(stream->nextChunk < stream->chunks)
+	{
+		data = stream->fill(stream->context, idle, stream->nextChunk * LCD_STREAM_CHUNK_BYTES, LCD_STREAM_CHUNK_BYTES);
+		stream->nextChunk++;
+	}
+	else
+	{
+		uint32_t length = stream->total - stream->offset;
+		if(length > LCD_STREAM_CHUNK_BYTES)
+		{
+			length = LCD_STREAM_CHUNK_BYTES;
+		}
+
+		data = stream->fill(stream->context, idle, stream->offset, length);
+		stream->tailData = data;
+		stream->tailLength = length;
+		stream->offset += length;
+	}
+
+	lcdSelectDisplay(selected);
+
+	HAL_DMAEx_ChangeMemory(hdma, (uint32_t)data, buffer);
+}
+
+static void lcdStreamMemory0Done(DMA_HandleTypeDef *hdma)
+{
+	lcdStreamBufferDone(hdma, MEMORY0);
+}
+
+static void lcdStreamMemory1Done(DMA_HandleTypeDef *hdma)
+{
+	lcdStreamBufferDone(hdma, MEMORY1);
+}
+
+static void lcdStreamError(DMA_HandleTypeDef *hdma)
+{
+	LcdStream *stream = lcdFindStream(hdma);
+	if(stream != NULL)
+	{
+		lcdStreamAbort(stream);
+	}
+}
+
+uint8_t lcdStreamWindow(int x, int y, int width, int height, LcdStreamFill fill, void *context)
+{
+	if(fill == NULL || width <= 0 || height <= 0) return 0;
+
+	lcdWaitForTransfer();
+
+	LcdStream *stream = lcdSelectedStream();
+	stream->display = lcdGetDisplay();
+	stream->spi = lcdGetSpi();
+	if(fill != lcdStreamFillSolid)
+	{
+		// other sources overwrite the solid color kept in the scratch buffers
+		stream->filledBuffers[0] = stream->filledBuffers[1] = NULL;
+	}
+
+	stream->fill = fill;
+	stream->context = context;
+	stream->x = x;
+	stream->y = y;
+	stream->width = width;
+	stream->height = height;
+	stream->cyclesPerByte = lcdStreamCyclesPerByte(stream->spi);
+	stream->startCycles = Perf_Now();
+
+	lcdStreamStart(stream);
+	return 1;
+}
+
+/**
+ * @brief Writes the window address and sends the stream from its first byte.
+ */
+static void lcdStreamStart(LcdStream *stream)
+{
+	stream->total = (uint32_t)stream->width * stream->height * lcdGetPanel()->bytesPerPixel;
+	stream->chunks = stream->total / LCD_STREAM_CHUNK_BYTES;
+	stream->chunksDone = 0;
+	stream->pendingLength = 0;
+	stream->scratchIndex = 0;
+
+	// keep the tail at least half a chunk long, see the file comment
+	if(stream->chunks > 0 && (stream->total % LCD_STREAM_CHUNK_BYTES) < LCD_STREAM_CHUNK_BYTES / 2)
+	{
+		stream->chunks--;
+	}
+	if(stream->chunks < 2)
+	{
+		stream->chunks = 0;
+	}
+	stream->offset = stream->chunks * LCD_STREAM_CHUNK_BYTES;
+
+	lcdBeginRamWrite(stream->x, stream->y, stream->width, stream->height);
+	lcdSetSpiBusy();
+	stream->active = 1;
+
+	if(stream->chunks == 0)
+	{
+		// too short for double buffering, send it as normal transfers
+		stream->offset = 0;
+		if(!lcdStreamSendNext(stream))
+		{
+			lcdStreamFinish(stream);
+		}
+		return;
+	}
+
+	const uint8_t *first = stream->fill(stream->context, stream->scratch[0], 0, LCD_STREAM_CHUNK_BYTES);
+	const uint8_t *second = stream->fill(stream->context, stream->scratch[1], LCD_STREAM_CHUNK_BYTES, LCD_STREAM_CHUNK_BYTES);
+	stream->nextChunk = 2;
+
+	DMA_HandleTypeDef *hdma = stream->spi->hdmatx;
+	hdma->XferCpltCallback = lcdStreamMemory0Done;
+	hdma->XferM1CpltCallback = lcdStreamMemory1Done;
+	hdma->XferErrorCallback = lcdStreamError;
+	hdma->XferHalfCpltCallback = NULL;
+	hdma->XferM1HalfCpltCallback = NULL;
+
+	stream->checkCycles = Perf_Now();
+	stream->checkPosition = 0;
+	if(HAL_OK != HAL_DMAEx_MultiBufferStart_IT(hdma, (uint32_t)first, (uint32_t)&stream->spi->Instance->DR,
+											   (uint32_t)second, LCD_STREAM_CHUNK_BYTES / 2))
+	{
+		lcdStreamFinish(stream);
+		return;
+	}
+
+	// HAL_SPI_Transmit_DMA() is bypassed, enable the SPI DMA request by hand
+	__HAL_SPI_ENABLE(stream->spi);
+	SET_BIT(stream->spi->Instance->CR2, SPI_CR2_TXDMAEN);
+}
+
+uint32_t lcdStreamGetPosition()
+{
+	LcdStream *stream = lcdSelectedStream();
+
+	if(!stream->active) return stream->total;
+
+	uint32_t remaining = stream->spi->hdmatx->Instance->NDTR * 2;
+
+	if(stream->chunksDone < stream->chunks)
+	{
+		// a buffer switch not yet seen by the interrupt makes this lag, never lead
+		return stream->chunksDone * LCD_STREAM_CHUNK_BYTES + LCD_STREAM_CHUNK_BYTES - remaining;
+	}
+
+	return stream->transferStart + stream->transferLength - remaining;
+}
+
+uint8_t lcdStreamTransferComplete()
+{
+	LcdStream *stream = lcdSelectedStream();
+
+	if(!stream->active) return 0;
+
+	if(lcdStreamSendNext(stream)) return 1;
+
+	lcdStreamEnd(stream);
+	return 0;
+}
+
+static const uint8_t* lcdStreamFillSolid(void *context, uint8_t *buffer, uint32_t offset, uint32_t length)
+{
+	LcdStream *stream = context;
+
+	// both scratch buffers keep their content, so refill them only on a color change
+	if(stream->filledColor != stream->fillColor)
+	{
+		stream->filledColor = stream->fillColor;
+		stream->filledBuffers[0] = stream->filledBuffers[1] = NULL;
+	}
+
+	if(stream->filledBuffers[0] != buffer && stream->filledBuffers[1] != buffer)
+	{
+		uint16_t *pixels = (uint16_t*)buffer;
+		for(uint32_t i = 0; i < LCD_STREAM_CHUNK_BYTES / 2; i++)
+		{
+			pixels[i] = stream->fillColor;
+		}
+		stream->filledBuffers[stream->filledBuffers[0] == NULL ? 0 : 1] = buffer;
+	}
+
+	return buffer;
+}
+
+void lcdStreamFillRect(int x, int y, int width, int height, uint16_t color)
+{
+	lcdWaitForTransfer();
+
+	LcdStream *stream = lcdSelectedStream();
+	stream->fillColor = color;
+	lcdStreamWindow(x, y, width, height, lcdStreamFillSolid, stream);
+}
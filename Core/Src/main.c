@@ -30,6 +30,8 @@
 #include "ui.h"
 #include "fsm_controls.h"
 #include "uart_connection.h"
+#include "lcd_mirror.h"
+#include "perf.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -105,7 +107,9 @@ int main(void)
   MX_TIM14_Init();
   MX_USART3_UART_Init();
   /* USER CODE BEGIN 2 */
-
+  Perf_Init();
+  lcdSetRaceTheBeam(1);
+  lcdInitStart();
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -113,16 +117,16 @@ int main(void)
   HAL_TIM_PWM_Start(&htim10, TIM_CHANNEL_1);
   HAL_TIM_Encoder_Start(&htim8, TIM_CHANNEL_ALL);
   HAL_UART_Receive_IT(&huart3, &rxData, 1);
+  lcdMirrorStart();
 
-  lcdInit();
-  lcdFillBackground(BLACK);
-
+  // pre-render the first frame while the display is still booting
   Ui_SetCurrentPage(&homePage);
 
   while (1)
   {
-
-	  HAL_Delay(10000);
+	  lcdProcess();
+	  lcdMirrorProcess();
+	  Ui_Idle();
 	  //Ui_UpdateDHTData(23.5, 40);
     /* USER CODE END WHILE */
 
@@ -181,10 +185,7 @@ void SystemClock_Config(void)
 /* USER CODE BEGIN 4 */
 void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
 {
-    if (hspi == &hspi2) {
-        HAL_GPIO_WritePin(LCD_CS_GPIO_Port, LCD_CS_Pin, GPIO_PIN_SET);
-        lcdSpiBusy = 0;
-    }
+    lcdTransferCompleteCallback(hspi);
 }
 
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
@@ -193,6 +194,9 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
         __HAL_TIM_SET_COUNTER(&htim14, 0);
         HAL_TIM_Base_Start_IT(&htim14);
     }
+    else{
+        lcdTearingEffectCallback(GPIO_Pin);
+    }
 }
 void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 {
@@ -219,6 +223,10 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
         // restart IT reception
         HAL_UART_Receive_IT(&huart3, &rxData, 1);
     }
+    else
+    {
+        lcdMirrorReceiveCallback(huart);
+    }
 }
 
 void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
@@ -227,6 +235,10 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
     {
         transmit_it_flag = 0;
     }
+    else
+    {
+        lcdMirrorTransmitCompleteCallback(huart);
+    }
 }
 /* USER CODE END 4 */
 
@@ -0,0 +1,49 @@
+/*
+ * perf.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ */
+#include "perf.h"
+
+void Perf_Init()
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void Perf_Record(Perf_Counter *counter, uint32_t startCycles, uint32_t items)
+{
+	uint32_t cycles = Perf_Now() - startCycles; // wrap-around safe
+
+	counter->calls++;
+	counter->lastCycles = cycles;
+	if(cycles > counter->maxCycles)
+	{
+		counter->maxCycles = cycles;
+	}
+	counter->totalCycles += cycles;
+	counter->totalItems += items;
+}
+
+void Perf_Reset(Perf_Counter *counter)
+{
+	counter->calls = 0;
+	counter->lastCycles = 0;
+	counter->maxCycles = 0;
+	counter->totalCycles = 0;
+	counter->totalItems = 0;
+}
+
+uint32_t Perf_CyclesToUs(uint32_t cycles)
+{
+	return (uint32_t)(((uint64_t)cycles * 1000000u) / SystemCoreClock);
+}
+
+uint32_t Perf_ItemsPerSecond(const Perf_Counter *counter)
+{
+	if(counter->totalCycles == 0) return 0;
+
+	return (uint32_t)((counter->totalItems * SystemCoreClock) / counter->totalCycles);
+}
@@ -6,6 +6,10 @@
  */
 #include "ui.h"
 #include "uart_connection.h"
+#include "lcd_dlist.h"
+#include "ui_cache.h"
+#include "lcd_rle.h"
+#include "lcd_blit.h"
 
 // --- Static Global Variables ---
 
@@ -13,6 +17,18 @@
 static const Page *currentPage = NULL;
 /// @brief Index of the currently highlighted button on the currentPage.
 static int currentButtonIndex = 0;
+/// @brief Pages to return to, Ui_GoBack() shows the last one.
+static const Page *navStack[UI_NAV_DEPTH];
+static uint8_t navDepth = 0;
+/// @brief HAL tick of the last input event, see UI_PRERENDER_IDLE_MS.
+static uint32_t lastInputTick = 0;
+/// @brief Set while Ui_Idle() draws, the UI interrupts leave the framebuffer alone.
+static volatile uint8_t idleDrawing = 0;
+/// @brief Input events that arrived while idleDrawing, handled by Ui_Idle().
+static volatile uint8_t deferredInputs[UI_DEFERRED_INPUTS];
+static volatile uint8_t deferredCount = 0;
+/// @brief Buttons of the currentPage to repaint, bit n for the button at index n.
+static uint32_t dirtyButtons = 0;
 /// @brief Index of the currently active color theme.
 static int currentThemeIndex = 0;
 /// @brief Index of the currently selected brightness level.
@@ -21,21 +37,103 @@ static int currentBrightnesIndex = 0;
 static char bufTemperature[8] = "25.4";
 static char bufHumidity[8] = "30";
 static char bufPc[8] = "Off";
+static char bufBrightness[16];
 
 static uint8_t pcState = 0;
 
+static Ui_Source temperatureSource;
+static Ui_Source humiditySource;
+
+/// @brief Last DHT readings, reading n is kept at index n % UI_HISTORY_LENGTH.
+static float historyTemperature[UI_HISTORY_LENGTH];
+static float historyHumidity[UI_HISTORY_LENGTH];
+/// @brief Number of readings taken since start-up.
+static uint32_t historyTotal = 0;
+/// @brief Publishes historyTotal, the history list follows it.
+static Ui_Source historySource;
+
+/// @brief HAL tick of the last Ui_Process() frame.
+static uint32_t lastFrameTick = 0;
+/// @brief Set by Ui_Process() once per UI_FRAME_PERIOD_MS, the frame is drawn by Ui_Idle().
+static volatile uint8_t frameDue = 0;
+
+/// @brief Display list of the last drawn page, see Ui_DrawPage().
+LCD_DISPLAY_LIST(pageList, 512);
+
+Perf_Counter uiRepaintPerf;
+Perf_Counter uiTransitionPerf;
+Ui_PrerenderStats uiPrerenderStats;
+
+#if UI_BACKGROUND_POOL_BYTES > 0
+/// @brief Storage of the page backgrounds, filled from the start and emptied all at once.
+static uint8_t backgroundPool[UI_BACKGROUND_POOL_BYTES];
+static uint32_t backgroundPoolUsed = 0;
+#endif
+
+/**
+ * @brief An open overlay.
+ */
+typedef struct {
+	const Ui_Overlay *overlay;  ///< The overlay.
+	uint16_t *saved;            ///< Pixels beneath it in saveUnderPool, NULL if they were not saved.
+	uint32_t shownTick;         ///< HAL tick of the last Ui_ShowOverlay(), for the toast timeout.
+} Ui_OverlaySlot;
+
+/// @brief Open overlays, the last one is on top and has the focus.
+static Ui_OverlaySlot overlayStack[UI_OVERLAY_DEPTH];
+static uint8_t overlayCount = 0;
+/// @brief Save-under storage of the open overlays, used from the start like a stack.
+static uint16_t saveUnderPool[UI_OVERLAY_SAVE_PIXELS];
+static uint32_t saveUnderUsed = 0;
+
+/**
+ * @brief Slide of the current page onto the panel, see Ui_StartTransition().
+ */
+typedef struct {
+	int8_t direction;   ///< 1 the page enters at the end of the scroll axis, -1 at its start, 0 no slide.
+	uint16_t shown;     ///< Scan lines of the page already on the glass.
+} Ui_Transition;
+
+static Ui_Transition transition;
+
+// pages opened by buttons defined above them
+extern const Page settingsPage;
+extern const Page historyPage;
+
 //   ------- Function declarations ------
 
 /**
  * @brief Toggles the PC state between ON and OFF.
  *
  * This function is intended to be used as a callback for a button press.
- * When executed, it switches the PC state, updates the corresponding dynamic
- * label on the UI, and sends the new state over UART.
+ * It only asks for a confirmation, the state is switched by Action_ConfirmTogglePc().
  *
  * @param self Pointer to the Button structure that triggered this action.
  */
-static void Action_TogglePc(Button *self);
+static void Action_TogglePc(const Button *self);
+
+/**
+ * @brief Switches the PC state once the dialog was confirmed.
+ * @details Updates the corresponding dynamic label on the UI and sends the
+ * new state over UART.
+ * @param self Pointer to the dialog that was confirmed.
+ */
+static void Action_ConfirmTogglePc(const Ui_Overlay *self);
+
+/**
+ * @brief Draws an overlay: a framed box with one or two centered lines of text.
+ */
+static void Ui_DrawOverlay(const Ui_Overlay *overlay);
+
+/**
+ * @brief Gives an input event to the open overlays first.
+ * @details Toasts on top are hidden. A dialog takes the event: a press hides
+ * it, calling its onConfirm for a short one, encoder steps are dropped.
+ * @param press   Non-zero for a button press, zero for an encoder step.
+ * @param confirm Non-zero for a short press.
+ * @retval 1 if an overlay took the event, 0 if it goes to the page.
+ */
+static uint8_t Ui_RouteToOverlay(uint8_t press, uint8_t confirm);
 
 /**
  * @brief Draws a single button on the screen.
@@ -57,50 +155,227 @@ static void Ui_DrawLabel_Const(const Label_Const *label);
 
 /**
  * @brief Draws a text label on the screen.
- * @details Displays static text at a fixed position with dynamic text and background colors.
- * This function is used for dynamic text elements.
+ * @details Displays dynamic text in the fixed box of the label. Unless @p full
+ * is set, only the glyph cells whose character differs from the one drawn
+ * last are redrawn, unused cells at the end are cleared.
  * @param label Pointer to a constant Label object containing position, text, and color data.
- * @retval None
+ * @param full Non-zero to draw the whole box, as part of a page draw.
+ * @return Area of the redrawn cells, zero width when nothing changed.
  */
-static void Ui_DrawLabel_Dynamic(Label_Dynamic *label);
+static LcdRect Ui_DrawLabel_Dynamic(const Label_Dynamic *label, uint8_t full);
 
 /**
- * @brief Executes the action associated with the currently highlighted button.
- * @details This function is typically called in response to a long press event.
- * It retrieves the highlighted button from the current page and, if an
- * `onClick` callback is assigned, it invokes that function.
- * @retval None
+ * @brief Draws one visible row of a list, the selected item inverted.
+ * @param list List to draw.
+ * @param row  Row index, 0 for the top row. Rows past the last item are cleared.
+ * @return Area of the row.
  */
-static void Ui_ExecuteAction();
+static LcdRect Ui_DrawListRow(const Ui_List *list, uint8_t row);
 
 /**
- * @brief Navigates the user interface to the controls page.
- * @details This is a callback function assigned to a button's `onClick` handler.
- * It calls `Ui_SetCurrentPage` to display the `sensorsPage`.
- * @retval None
+ * @brief Reads the item count of a list and keeps the selection and the visible rows inside it.
+ * @details All rows are marked for redraw, the items may have changed.
  */
-static void Action_GoToControls(Button *self);
+static void Ui_SyncList(const Ui_List *list);
 
 /**
- * @brief Navigates the user interface to the sensors page.
- * @details This is a callback function assigned to a button's `onClick` handler.
- * It calls `Ui_SetCurrentPage` to display the `sensorsPage`.
- * @retval None
+ * @brief Shifts the visible items of a list by @p delta rows, positive moves them up.
+ * @details Only the rows exposed by the shift are marked for redraw, the
+ * pixels of the others are moved by the next repaint.
+ */
+static void Ui_ScrollList(const Ui_List *list, int delta);
+
+/**
+ * @brief Moves the selection of a list to the next or previous item, scrolling it into view.
+ */
+static void Ui_MoveListSelection(const Ui_List *list, uint8_t dirDown);
+
+/**
+ * @brief Repaints the invalidated widgets of the current page.
+ * @details Dirty buttons are copied from the render cache, or get their
+ * rectangle restored to the page background and are drawn again (and
+ * cached). Dirty labels redraw their changed glyph cells, a scrolled list
+ * moves its rows and draws the exposed ones. The bounding box of the repainted areas is sent by a single flush.
+ * With a banded framebuffer the whole page is re-rendered instead.
+ */
+static void Ui_RepaintDirty();
+
+/**
+ * @brief Formats the text of a bound label if its source changed since the last call.
+ * @param label Label to update.
+ * @retval 1 if the text changed and the label has to be repainted, 0 otherwise.
+ */
+static uint8_t Ui_UpdateBinding(const Label_Dynamic *label);
+
+/**
+ * @brief Formats a temperature in Celsius, e.g. "23.5C".
+ */
+static void Ui_FormatTemperature(char *text, size_t size, float value);
+
+/**
+ * @brief Formats a relative humidity, e.g. "40.0%".
+ */
+static void Ui_FormatHumidity(char *text, size_t size, float value);
+
+/**
+ * @brief Issues the drawing calls of the whole current page.
+ * @details Used both for recording the page display list and, when the
+ * list is too small, for drawing the page directly.
+ */
+static void Ui_RenderPage();
+
+/**
+ * @brief Draws the part of a page that never changes.
+ * @details Fill, constant labels and every button in the normal state.
+ */
+static void Ui_RenderPageStatic(const Page *page);
+
+/**
+ * @brief What is kept of a page while it is not shown.
+ */
+typedef struct {
+	LcdRleImage background;  ///< Compressed static layer, empty (size 0) until rendered.
+	uint32_t renderCycles;   ///< Time it took to render the static layer.
+	uint8_t noRoom;          ///< The background did not fit into the pool, it is not tried again.
+	uint8_t focus;           ///< Highlighted button when the page was left.
+} Ui_PageState;
+
+/**
+ * @brief Gives the kept state of a page.
+ * @return The state, NULL for a page missing from pages[].
+ */
+static Ui_PageState* Ui_GetPageState(const Page *page);
+
+/**
+ * @brief Gives the background of a page.
+ * @param create Non-zero to render and encode a missing background, the
+ *               framebuffer contents are overwritten.
+ * @return The background, NULL if the page has none.
+ */
+static const LcdRleImage* Ui_GetPageBackground(const Page *page, uint8_t create);
+
+/**
+ * @brief Switches to a page with the focus it had when it was left and draws it.
+ * @param direction 1 slides the page in from the right (bottom on portrait
+ *                  panels), -1 from the left (top), 0 cuts to it.
+ */
+static void Ui_ShowPage(const Page *page, int8_t direction);
+
+/**
+ * @brief Renders the current page and starts sliding it over the previous one.
+ * @details The panel scrolls the previous page out by itself, every step
+ * sends just the strip of the new page scrolled in, see Ui_StepTransition().
+ * @param previous Page shown on the panel.
+ * @param direction Side the page enters from, see Ui_ShowPage().
+ * @retval 1 if the slide started, 0 if the page has to be drawn with a cut
+ *         (UI_TRANSITION_STEPS is 0, the panel cannot scroll, the
+ *         framebuffer is banded or the pages use different displays).
+ */
+static uint8_t Ui_StartTransition(const Page *previous, int8_t direction);
+
+/**
+ * @brief Sends the next strip of the sliding page and scrolls it in.
+ * @param all Non-zero to send the rest of the page at once.
+ */
+static void Ui_StepTransition(uint8_t all);
+
+/**
+ * @brief Completes a running slide, for anything about to draw over the panel.
+ */
+static void Ui_FinishTransition();
+
+/**
+ * @brief Brings the state of the current page up to date before it is rendered.
+ * @details Catches up the bound labels and the list and drops the pixels
+ * saved beneath the overlays. A missing page background is not created
+ * here, it takes too long for the interrupts drawing pages, Ui_Idle()
+ * creates it.
+ */
+static void Ui_PreparePage();
+
+/**
+ * @brief Renders the background of the current page or of one page reachable
+ * from the focus ahead of time.
+ * @details Only while the UI is idle: no input for UI_PRERENDER_IDLE_MS,
+ * nothing to repaint, no overlay and no transfer reading the framebuffer.
+ * The page is rendered into the framebuffer, encoded, and the shown page
+ * is rendered back before anything is sent. Called by Ui_Idle() with
+ * idleDrawing set.
+ * @param now Current HAL tick.
+ */
+static void Ui_Prerender(uint32_t now);
+
+/**
+ * @brief Input events of Ui_DeferInput().
+ */
+typedef enum {
+	UI_INPUT_SHORT_PRESS,
+	UI_INPUT_LONG_PRESS,
+	UI_INPUT_MOVE_UP,
+	UI_INPUT_MOVE_DOWN,
+} Ui_Input;
+
+/**
+ * @brief Keeps an input event for the next Ui_Idle() while Ui_Idle() draws.
+ * @details Events that come after a kept one are kept too, so they are
+ * handled in order.
+ * @retval 1 if the event was kept (or dropped, the queue being full), 0 if
+ *         it has to be handled now.
+ */
+static uint8_t Ui_DeferInput(Ui_Input input);
+
+/**
+ * @brief Handles the input events kept by Ui_DeferInput().
+ */
+static void Ui_HandleDeferredInputs();
+
+/**
+ * @brief Handlers of the input events, for the interrupts and for the kept events.
+ */
+static void Ui_HandleShortPress();
+static void Ui_HandleLongPress();
+static void Ui_HandleMove(uint8_t dirDown);
+
+/**
+ * @brief Draws what changed since the last frame, see Ui_Process().
+ * @param now Current HAL tick.
+ */
+static void Ui_DrawFrame(uint32_t now);
+
+/**
+ * @brief Drops the backgrounds of all pages, e.g. when the buttons change their look.
  */
-static void Action_GoToSensors(Button *self);
+static void Ui_ResetPageBackgrounds();
 
 /**
- * @brief Navigates the user interface to the settings page.
- * @details This is a callback function assigned to a button's `onClick` handler.
- * It calls `Ui_SetCurrentPage` to display the `settingsPage`.
+ * @brief Selects the display of the current page for the following lcd* calls.
+ * @return The previously selected display, to be restored with lcdSelectDisplay().
+ */
+static LcdDisplay* Ui_SelectPageDisplay();
+
+/**
+ * @brief Executes the action associated with the currently highlighted button.
+ * @details This function is typically called in response to a long press event.
+ * It retrieves the highlighted button from the current page and opens its
+ * `target` page or, if an `onClick` callback is assigned, invokes that function.
  * @retval None
  */
-static void Action_GoToSettings();
+static void Ui_ExecuteAction();
+
+/**
+ * @brief Item count of the history list, the number of readings kept.
+ */
+static uint32_t Ui_HistoryCount();
+
+/**
+ * @brief Text of a history list item, e.g. "12 23.5C 40%", oldest reading first.
+ */
+static void Ui_HistoryItem(uint32_t index, char *text, size_t size);
 
 /**
- * @brief Navigates the user interface back to the home page.
+ * @brief Navigates the user interface back to the previous page.
  * @details This is a callback function for a "return" or "back" button.
- * It calls `Ui_SetCurrentPage` to display the `homePage`.
+ * It calls `Ui_GoBack`, the `homePage` is shown when there is no previous page.
  * @retval None
  */
 static void Action_GoBack();
@@ -132,6 +407,17 @@ static const uint8_t brightnessLevels[] = {
 
 #define Num_Of_Brightness_Levels (sizeof(brightnessLevels) / sizeof(brightnessLevels[0]))
 
+static const Ui_Overlay brightnessToast = {
+	.x = 20,
+	.y = 54,
+	.width = 120,
+	.height = 20,
+	.message = bufBrightness,
+	.textColor = WHITE,
+	.bgColor = BLACK,
+	.timeoutMs = 1000,
+};
+
 //   ------- Themes ------
 
 static const Theme themes[] = {
@@ -142,17 +428,19 @@ static const Theme themes[] = {
 
 #define Num_Of_Themes (sizeof(themes) / sizeof(themes[0]))
 
+/// @brief Theme slot of the menu buttons, see Ui_ChangeMenuTheme().
+static const Theme *menuTheme = &themes[0];
+
 //   ------- Return Button ------
 
-static Button returnButton ={
+static const Button returnButton ={
 	.x = 7,
 	.y = 105,
 	.width = BTN_RETURN_WIDTH,
 	.height = BTN_RETURN_HEIGHT,
 	.radius = BTN_RETURN_RADIUS,
 	.text = "<",
-	.textColor = BLACK,
-	.bgColor = BLUE,
+	.theme = &menuTheme,
 	.onClick = Action_GoBack
 };
 
@@ -165,36 +453,51 @@ static const Label_Const controlsLabelConst1 ={
 		.bgColor = BLACK,
 };
 
-static Label_Dynamic controlsLabelDynamic1 ={
+static Label_Dynamic_State controlsLabelDynamic1State;
+
+static const Label_Dynamic controlsLabelDynamic1 ={
 		.x = 108,
 		.y = 15,
 		.text = "1",
 		.textColor = WHITE,
 		.bgColor = BLACK,
 		.dataPtr = bufPc,
+		.maxChars = 3,
+		.state = &controlsLabelDynamic1State,
 };
 
-static Button controlsButton1 ={
+static const Button controlsButton1 ={
 	.x = 25,
 	.y = 35,
 	.width = BTN_DEFAULT_WIDTH,
 	.height = BTN_DEFAULT_HEIGHT,
 	.radius = BTN_DEFAULT_RADIUS,
 	.text = "Przelacz",
-	.textColor = BLACK,
-	.bgColor = BLUE,
+	.theme = &menuTheme,
 	.onClick = Action_TogglePc
 };
 
+static const Ui_Overlay controlsDialog = {
+	.x = 10,
+	.y = 39,
+	.width = 140,
+	.height = 50,
+	.title = "Przelaczyc PC?",
+	.message = "Krotko: tak",
+	.textColor = WHITE,
+	.bgColor = BLACK,
+	.onConfirm = Action_ConfirmTogglePc,
+};
+
 static const Label_Const* const controlsLabelsConst[] = {
 	  &controlsLabelConst1,
 };
 
-static Label_Dynamic* const controlsLabelsDynamic[] = {
+static const Label_Dynamic* const controlsLabelsDynamic[] = {
 	  &controlsLabelDynamic1,
 };
 
-static Button* const controlsButtons[] = {
+static const Button* const controlsButtons[] = {
 		&controlsButton1,
 		&returnButton,
 };
@@ -232,22 +535,36 @@ static const Label_Const sensorsLabelConst2 ={
 		.bgColor = BLACK,
 };
 
-static Label_Dynamic sensorsLabelDynamic1 ={
-		.x = 108,
+static Label_Dynamic_State sensorsLabelDynamic1State;
+
+static const Label_Dynamic sensorsLabelDynamic1 ={
+		.x = 105,
 		.y = 15,
 		.text = "1",
 		.textColor = WHITE,
 		.bgColor = BLACK,
 		.dataPtr = bufTemperature,
+		.maxChars = 6,
+		.source = &temperatureSource,
+		.format = Ui_FormatTemperature,
+		.dataSize = sizeof(bufTemperature),
+		.state = &sensorsLabelDynamic1State,
 };
 
-static  Label_Dynamic sensorsLabelDynamic2 ={
+static Label_Dynamic_State sensorsLabelDynamic2State;
+
+static const Label_Dynamic sensorsLabelDynamic2 ={
 		.x = 105,
 		.y = 40,
 		.text = "2",
 		.textColor = WHITE,
 		.bgColor = BLACK,
 		.dataPtr = bufHumidity,
+		.maxChars = 6,
+		.source = &humiditySource,
+		.format = Ui_FormatHumidity,
+		.dataSize = sizeof(bufHumidity),
+		.state = &sensorsLabelDynamic2State,
 };
 
 static const Label_Const* const sensorsLabelsConst[] = {
@@ -255,12 +572,12 @@ static const Label_Const* const sensorsLabelsConst[] = {
 	  &sensorsLabelConst2,
 };
 
-static Label_Dynamic* const sensorsLabelsDynamic[] = {
+static const Label_Dynamic* const sensorsLabelsDynamic[] = {
 	  &sensorsLabelDynamic1,
 	  &sensorsLabelDynamic2,
 };
 
-static Button* const sensorsButtons[] = {
+static const Button* const sensorsButtons[] = {
 	  &returnButton,
 };
 
@@ -282,44 +599,41 @@ const Page sensorsPage = {
 
 //   ------- HOME PAGE ------
 
-static Button homeButton1 ={
+static const Button homeButton1 ={
 	.x = 25,
 	.y = 15,
 	.width = BTN_DEFAULT_WIDTH,
 	.height = BTN_DEFAULT_HEIGHT,
 	.radius = BTN_DEFAULT_RADIUS,
 	.text = "Ustawienia",
-	.textColor = BLACK,
-	.bgColor = BLUE,
-	.onClick = Action_GoToSettings
+	.theme = &menuTheme,
+	.target = &settingsPage
 };
 
-static Button homeButton2={
+static const Button homeButton2 ={
 	  .x = 25,
 	  .y = 50,
 	  .width = BTN_DEFAULT_WIDTH,
 	  .height = BTN_DEFAULT_HEIGHT,
 	  .radius = BTN_DEFAULT_RADIUS,
 	  .text = "Temperatura",
-	  .textColor = BLACK,
-	  .bgColor = BLUE,
-	  .onClick = Action_GoToSensors
+	  .theme = &menuTheme,
+	  .target = &sensorsPage
 };
 
-static Button homeButton3 = {
+static const Button homeButton3 = {
 	  .x = 25,
 	  .y = 85,
 	  .width = BTN_DEFAULT_WIDTH,
 	  .height = BTN_DEFAULT_HEIGHT,
 	  .radius = BTN_DEFAULT_RADIUS,
 	  .text = "Sterowanie",
-	  .textColor = BLACK,
-	  .bgColor = BLUE,
-	  .onClick = Action_GoToControls
+	  .theme = &menuTheme,
+	  .target = &controlsPage
 };
 
 
-static Button* const menuButtons[] = {
+static const Button* const menuButtons[] = {
 	  &homeButton1,
 	  &homeButton2,
 	  &homeButton3,
@@ -334,44 +648,41 @@ const Page homePage = {
 
 //   ------- SETTINGS PAGE ------
 
-static Button settingsButton1 ={
+static const Button settingsButton1 ={
 	.x = 25,
 	.y = 15,
 	.width = BTN_DEFAULT_WIDTH,
 	.height = BTN_DEFAULT_HEIGHT,
 	.radius = BTN_DEFAULT_RADIUS,
 	.text = "Motyw",
-	.textColor = BLACK,
-	.bgColor = BLUE,
+	.theme = &menuTheme,
 	.onClick = Action_ChangeTheme
 };
 
-static Button settingsButton2={
+static const Button settingsButton2 ={
 	  .x = 25,
 	  .y = 50,
 	  .width = BTN_DEFAULT_WIDTH,
 	  .height = BTN_DEFAULT_HEIGHT,
 	  .radius = BTN_DEFAULT_RADIUS,
 	  .text = "Jasnosc",
-	  .textColor = BLACK,
-	  .bgColor = BLUE,
+	  .theme = &menuTheme,
 	  .onClick = Action_ChangeBrightness
 };
 
-static Button settingsButton3 = {
+static const Button settingsButton3 = {
 	  .x = 25,
 	  .y = 85,
 	  .width = BTN_DEFAULT_WIDTH,
 	  .height = BTN_DEFAULT_HEIGHT,
 	  .radius = BTN_DEFAULT_RADIUS,
-	  .text = "Place holder",
-	  .textColor = BLACK,
-	  .bgColor = BLUE,
-	  .onClick = NULL,
+	  .text = "Historia",
+	  .theme = &menuTheme,
+	  .target = &historyPage,
 };
 
 
-static Button* const settingsButtons[] = {
+static const Button* const settingsButtons[] = {
 	  &settingsButton1,
 	  &settingsButton2,
 	  &settingsButton3,
@@ -385,6 +696,37 @@ const Page settingsPage = {
 		  .buttonCount = Num_Of_Settings_Buttons
 };
 
+//   ------- History PAGE ------
+
+static Ui_List_State historyListState;
+
+static const Ui_List historyList = {
+	.x = 5,
+	.y = 5,
+	.width = 150,
+	.rowHeight = FONT_HEIGHT + 2,
+	.rows = 9,
+	.textColor = WHITE,
+	.bgColor = BLACK,
+	.count = Ui_HistoryCount,
+	.item = Ui_HistoryItem,
+	.source = &historySource,
+	.state = &historyListState,
+};
+
+static const Button* const historyButtons[] = {
+	  &returnButton,
+};
+
+#define Num_Of_History_Buttons (sizeof(historyButtons) / sizeof(historyButtons[0]))
+
+const Page historyPage = {
+		.buttons = historyButtons,
+		.buttonCount = Num_Of_History_Buttons,
+
+		.list = &historyList,
+};
+
 //   ------- PAGES ------
 
 const Page* const pages[] = {
@@ -392,51 +734,50 @@ const Page* const pages[] = {
 		&controlsPage,
 		&homePage,
 		&sensorsPage,
+		&historyPage,
 };
 
 #define Num_Of_Pages (sizeof(pages) / sizeof(pages[0]))
 
+/// @brief Kept state of every page in pages[].
+static Ui_PageState pageStates[Num_Of_Pages];
+
 // ------------------------------------------------------
 
-static void Action_ChangeBrightness(Button *self)
+static void Action_ChangeBrightness(const Button *self)
 {
 	currentBrightnesIndex = (currentBrightnesIndex + 1) % Num_Of_Brightness_Levels;
 
 		HW_setBacklightBrightness(brightnessLevels[currentBrightnesIndex]);
+
+	snprintf(bufBrightness, sizeof(bufBrightness), "Jasnosc %u%%", brightnessLevels[currentBrightnesIndex]);
+	Ui_ShowOverlay(&brightnessToast);
+}
+
+static void Action_TogglePc(const Button *self)
+{
+	Ui_ShowOverlay(&controlsDialog);
 }
 
-static void Action_TogglePc(Button *self)
+static void Action_ConfirmTogglePc(const Ui_Overlay *self)
 {
 	pcState = ! pcState;
-	snprintf(bufPc, sizeof(bufPc), "%s", pcState ? "On " : "Off");
+	snprintf(bufPc, sizeof(bufPc), "%s", pcState ? "On" : "Off");
 	Uart_sendPcState(pcState);
-	Ui_DrawLabel_Dynamic(&controlsLabelDynamic1);
-	lcdCopy();
+	controlsLabelDynamic1State.dirty = 1;
+	Ui_RepaintDirty();
 }
 
-static void Action_ChangeTheme(Button *self)
+static void Action_ChangeTheme(const Button *self)
 {
 	currentThemeIndex = (currentThemeIndex + 1) % Num_Of_Themes;
 
-	Ui_ChangeMenuTheme(themes[currentThemeIndex].textColor, themes[currentThemeIndex].bgColor);
-}
-
-static void Action_GoToSensors(Button *self){
-	Ui_SetCurrentPage(&sensorsPage);
-}
-
-static void Action_GoToControls(Button *self){
-	Ui_SetCurrentPage(&controlsPage);
+	Ui_ChangeMenuTheme(&themes[currentThemeIndex]);
 }
 
-static void Action_GoToSettings(Button *self)
+static void Action_GoBack(const Button *self)
 {
-	Ui_SetCurrentPage(&settingsPage);
-}
-
-static void Action_GoBack(Button *self)
-{
-	Ui_SetCurrentPage(&homePage);
+	Ui_GoBack(&homePage);
 }
 
 static void Ui_ExecuteAction()
@@ -444,15 +785,19 @@ static void Ui_ExecuteAction()
 	if(currentPage == NULL || currentPage->buttonCount == 0) return;
 
 	// choose highlithed button
-	Button *btn = currentPage->buttons[currentButtonIndex];
+	const Button *btn = currentPage->buttons[currentButtonIndex];
 
-	if(btn->onClick != NULL){
+	if(btn->target != NULL){
+		Ui_OpenPage(btn->target);
+	}
+	else if(btn->onClick != NULL){
 		btn->onClick(btn);
 	}
 }
 
 static void Ui_DrawButton(const Button *btn, uint8_t isHighlited)
 {
+	const Theme *theme = *btn->theme;
 
 	if(isHighlited)
 	{
@@ -468,7 +813,7 @@ static void Ui_DrawButton(const Button *btn, uint8_t isHighlited)
 			lcdDrawText(btn->x + (btn->width - ((FONT_WIDTH+1)*strlen(btn->text)))/2,
 						btn->y + (btn->height - FONT_HEIGHT)/2,
 						btn->text,
-						btn->textColor,
+						theme->textColor,
 						HIGHLIGHT_COLOR);
 	}
 	else
@@ -479,14 +824,14 @@ static void Ui_DrawButton(const Button *btn, uint8_t isHighlited)
 						  btn->width,
 						  btn->height,
 						  btn->radius,
-						  btn->bgColor);
+						  theme->bgColor);
 
 	//draw text center aligned
 	lcdDrawText(btn->x + (btn->width - ((FONT_WIDTH+1)*strlen(btn->text)))/2,
 				btn->y + (btn->height - FONT_HEIGHT)/2,
 				btn->text,
-				btn->textColor,
-				btn->bgColor);
+				theme->textColor,
+				theme->bgColor);
 	}
 }
 
@@ -498,103 +843,1165 @@ static void Ui_DrawLabel_Const(const Label_Const *label){
 				label->bgColor);
 }
 
-static void Ui_DrawLabel_Dynamic(Label_Dynamic *label){
+static LcdRect Ui_DrawLabel_Dynamic(const Label_Dynamic *label, uint8_t full){
 
     const char *textToDraw = label->dataPtr ? label->dataPtr : label->text;
-    lcdDrawText(label->x, label->y, textToDraw, label->textColor, label->bgColor);
+    int first = label->maxChars;
+    int last = -1;
+
+    if(full){
+        lcdFillRectangle(label->x, label->y, label->maxChars * (FONT_WIDTH + 1), FONT_HEIGHT, label->bgColor);
+    }
+
+    for(int i = 0; i < label->maxChars; i++)
+    {
+        // cells after the end of the text are blank
+        char c = *textToDraw ? *textToDraw++ : ' ';
+        if(!full && c == label->state->drawn[i]) continue;
+
+        char glyph[2] = { c, '\0' };
+        lcdDrawText(label->x + i * (FONT_WIDTH + 1), label->y, glyph, label->textColor, label->bgColor);
+        label->state->drawn[i] = c;
+
+        if(i < first) first = i;
+        last = i;
+    }
+
+    label->state->drawn[label->maxChars] = '\0';
+    label->state->dirty = 0;
+
+    LcdRect area = { 0, 0, 0, 0 };
+    if(last >= first)
+    {
+        area.x = label->x + first * (FONT_WIDTH + 1);
+        area.y = label->y;
+        area.width = (last - first) * (FONT_WIDTH + 1) + FONT_WIDTH;
+        area.height = FONT_HEIGHT;
+    }
+    return area;
 }
 
-void Ui_DrawPage(){
+/**
+ * @brief Mask with a bit for every visible row of a list.
+ */
+static uint32_t Ui_ListRowsMask(const Ui_List *list)
+{
+	return list->rows >= 32 ? 0xffffffffUL : (1UL << list->rows) - 1;
+}
 
-	if(currentPage == NULL) return;
+static LcdRect Ui_DrawListRow(const Ui_List *list, uint8_t row)
+{
+	const Ui_List_State *state = list->state;
+	uint32_t index = state->first + row;
+	LcdRect area = { list->x, list->y + row * list->rowHeight, list->width, list->rowHeight };
 
-	lcdFillBackground(BACKGROUND_COLOR);
+	uint16_t textColor = list->textColor;
+	uint16_t bgColor = list->bgColor;
+	if(index == state->selected)
+	{
+		textColor = list->bgColor;
+		bgColor = list->textColor;
+	}
 
-	for(size_t i = 0; i < currentPage->label_Const_Count; i++){
-		Ui_DrawLabel_Const(currentPage->labels_Const[i]);
+	if(index >= state->count)
+	{
+		lcdFillRectangle(area.x, area.y, area.width, area.height, list->bgColor);
+		return area;
 	}
 
-	for(size_t i = 0; i < currentPage->label_Dynamic_Count; i++){
-		Ui_DrawLabel_Dynamic(currentPage->labels_Dynamic[i]);
+	char text[UI_LIST_TEXT_MAX];
+	list->item(index, text, sizeof(text));
+
+	lcdFillRectangle(area.x, area.y, area.width, area.height, bgColor);
+
+	// long texts are cut at the end of the row
+	lcdSetClipRect(area.x, area.y, area.width, area.height);
+	lcdDrawText(area.x + 2, area.y + (area.height - FONT_HEIGHT) / 2, text, textColor, bgColor);
+	lcdResetClipRect();
+	return area;
+}
+
+static void Ui_SyncList(const Ui_List *list)
+{
+	Ui_List_State *state = list->state;
+	state->count = list->count();
+	if(list->source != NULL)
+	{
+		state->version = list->source->version;
 	}
 
-	for(size_t i = 0; i < currentPage->buttonCount; i++)
+	if(state->selected >= state->count)
 	{
-		uint8_t isHihglithed  = (i == currentButtonIndex);
-		Ui_DrawButton(currentPage->buttons[i], isHihglithed);
+		state->selected = state->count > 0 ? state->count - 1 : 0;
+	}
+	if(state->first + list->rows > state->count)
+	{
+		// no empty rows at the bottom while there are items above the top one
+		state->first = state->count > list->rows ? state->count - list->rows : 0;
+	}
+	if(state->selected < state->first)
+	{
+		state->first = state->selected;
+	}
+	else if(state->selected >= state->first + list->rows)
+	{
+		state->first = state->selected - list->rows + 1;
 	}
-	lcdCopy();
+
+	state->scroll = 0;
+	state->dirtyRows = Ui_ListRowsMask(list);
 }
 
-void Ui_SetCurrentPage(const Page *newPage)
+static void Ui_ScrollList(const Ui_List *list, int delta)
 {
-	if(newPage == NULL) return;
+	Ui_List_State *state = list->state;
+	uint32_t all = Ui_ListRowsMask(list);
 
-	currentPage = newPage;
-	currentButtonIndex = 0;
+	state->first += delta;
+	state->scroll += delta;
 
-	Ui_DrawPage();
+	if(delta >= list->rows || -delta >= list->rows)
+	{
+		state->dirtyRows = all;
+	}
+	else if(delta > 0)
+	{
+		// rows move up, the bottom ones are exposed
+		state->dirtyRows = ((state->dirtyRows >> delta) | ~(all >> delta)) & all;
+	}
+	else if(delta < 0)
+	{
+		state->dirtyRows = ((state->dirtyRows << -delta) | ~(all << -delta)) & all;
+	}
 }
 
-void Ui_ChangeMenuTheme( uint16_t changedTextColor, uint16_t changedBgColor)
+static void Ui_MoveListSelection(const Ui_List *list, uint8_t dirDown)
 {
+	Ui_List_State *state = list->state;
+	if(state->count == 0) return;
+	if(dirDown ? state->selected + 1 >= state->count : state->selected == 0) return;
 
-	for(int page = 0; page < Num_Of_Pages; page++){
-		for(int btn = 0; btn < Num_Of_Menu_Buttons; btn++ )
-		{
-			pages[page]->buttons[btn]->textColor = changedTextColor;
-			pages[page]->buttons[btn]->bgColor = changedBgColor;
-		}
-	}
+	// the selection is always on a visible row
+	state->dirtyRows |= 1UL << (state->selected - state->first);
+	state->selected += dirDown ? 1 : -1;
 
-	Ui_DrawPage();
+	if(state->selected < state->first)
+	{
+		Ui_ScrollList(list, -1);
+	}
+	else if(state->selected >= state->first + list->rows)
+	{
+		Ui_ScrollList(list, 1);
+	}
+	state->dirtyRows |= 1UL << (state->selected - state->first);
 }
 
-void Ui_MoveHighlight(uint8_t dirDown)
+static void Ui_RenderPageStatic(const Page *page)
 {
-    if (currentPage == NULL || currentPage->buttonCount == 0) return;
+	lcdFillBackground(BACKGROUND_COLOR);
 
-    if (dirDown)
-    {
-        currentButtonIndex++;
-        if (currentButtonIndex >= currentPage->buttonCount)
-            currentButtonIndex = 0;
-    }
-    else
-    {
-        if (currentButtonIndex == 0)
-            currentButtonIndex = currentPage->buttonCount - 1;
-        else
-            currentButtonIndex--;
-    }
+	for(size_t i = 0; i < page->label_Const_Count; i++){
+		Ui_DrawLabel_Const(page->labels_Const[i]);
+	}
 
-    Ui_DrawPage();
+	for(size_t i = 0; i < page->buttonCount; i++)
+	{
+		Ui_DrawButton(page->buttons[i], 0);
+	}
 }
 
-void Ui_UpdateDHTData(float temperature, float humidity)
+static Ui_PageState* Ui_GetPageState(const Page *page)
+{
+	for(size_t i = 0; i < Num_Of_Pages; i++)
+	{
+		if(pages[i] == page) return &pageStates[i];
+	}
+	return NULL;
+}
+
+static const LcdRleImage* Ui_GetPageBackground(const Page *page, uint8_t create)
 {
-    snprintf(bufTemperature, sizeof(bufTemperature), "%.1fC", temperature);
-    snprintf(bufHumidity, sizeof(bufHumidity), "%.1f%%", humidity);
+#if UI_BACKGROUND_POOL_BYTES > 0
+	Ui_PageState *state = Ui_GetPageState(page);
+	if(state == NULL) return NULL;
+
+	LcdRleImage *background = &state->background;
+	if(background->size > 0) return background;
+	if(!create || state->noRoom || lcdIsBanded()) return NULL;
+
+	// the static layer is drawn straight into the framebuffer, it must not be on its way out
+	lcdWaitForTransfer();
+	uint32_t start = Perf_Now();
+	Ui_RenderPageStatic(page);
+	state->renderCycles = Perf_Now() - start;
+
+	LcdRect screen = { 0, 0, lcdGetWidth(), lcdGetHeight() };
+	uint32_t size = lcdRleEncode(&screen, &backgroundPool[backgroundPoolUsed],
+								 UI_BACKGROUND_POOL_BYTES - backgroundPoolUsed);
+
+	// the framebuffer no longer holds the presented frame
+	lcdDisplayListInvalidate();
+	if(size == 0)
+	{
+		state->noRoom = 1;
+		return NULL;
+	}
 
-    if(currentPage == &sensorsPage){
-        Ui_DrawLabel_Dynamic(&sensorsLabelDynamic1);
-        Ui_DrawLabel_Dynamic(&sensorsLabelDynamic2);
-        lcdCopy();
-    }
+	background->data = &backgroundPool[backgroundPoolUsed];
+	background->size = size;
+	background->width = screen.width;
+	background->height = screen.height;
+	backgroundPoolUsed += size;
+	return background;
+#else
+	return NULL;
+#endif
 }
 
-void Ui_FSM_ShortPressActionDetected()
+static void Ui_ResetPageBackgrounds()
 {
-	Ui_ExecuteAction();
+#if UI_BACKGROUND_POOL_BYTES > 0
+	for(size_t i = 0; i < Num_Of_Pages; i++)
+	{
+		pageStates[i].background.size = 0;
+		pageStates[i].noRoom = 0;
+	}
+	backgroundPoolUsed = 0;
+#endif
 }
 
-void Ui_FSM_LongPressActionDetected()
+static void Ui_RenderPage()
 {
-	Ui_ExecuteAction();
+	const LcdRleImage *background = Ui_GetPageBackground(currentPage, 0);
+	if(background != NULL)
+	{
+		lcdDrawRleImage(background, 0, 0);
+	}
+	else
+	{
+		Ui_RenderPageStatic(currentPage);
+	}
+
+	for(size_t i = 0; i < currentPage->label_Dynamic_Count; i++){
+		Ui_DrawLabel_Dynamic(currentPage->labels_Dynamic[i], 1);
+	}
+
+	const Ui_List *list = currentPage->list;
+	if(list != NULL)
+	{
+		for(uint8_t row = 0; row < list->rows; row++)
+		{
+			Ui_DrawListRow(list, row);
+		}
+		list->state->scroll = 0;
+		list->state->dirtyRows = 0;
+	}
+
+	for(size_t i = 0; i < currentPage->buttonCount; i++)
+	{
+		// the background already shows the buttons in the normal state
+		uint8_t isHihglithed  = (i == currentButtonIndex);
+		if(background == NULL || isHihglithed)
+		{
+			Ui_DrawButton(currentPage->buttons[i], isHihglithed);
+		}
+	}
+	dirtyButtons = 0;
+
+	for(uint8_t i = 0; i < overlayCount; i++)
+	{
+		Ui_DrawOverlay(overlayStack[i].overlay);
+	}
 }
 
-void Ui_MoveActionDetected(uint8_t dirDown)
+static LcdDisplay* Ui_SelectPageDisplay()
 {
+	LcdDisplay *pageDisplay = currentPage->display;
+	if(pageDisplay == NULL)
+	{
+		pageDisplay = lcdGetDefaultDisplay();
+	}
+	return lcdSelectDisplay(pageDisplay);
+}
+
+static void Ui_PreparePage()
+{
+	// bound labels are not formatted while their page is hidden, catch up
+	for(size_t i = 0; i < currentPage->label_Dynamic_Count; i++){
+		Ui_UpdateBinding(currentPage->labels_Dynamic[i]);
+	}
+	if(currentPage->list != NULL)
+	{
+		Ui_SyncList(currentPage->list);
+	}
+
+	// the page beneath the overlays changes, what they saved is outdated
+	for(uint8_t i = 0; i < overlayCount; i++)
+	{
+		overlayStack[i].saved = NULL;
+	}
+}
+
+void Ui_DrawPage(){
+
+	if(currentPage == NULL) return;
+
+	Ui_FinishTransition();
+	LcdDisplay *selected = Ui_SelectPageDisplay();
+	Ui_PreparePage();
+
+	// record the page, an unchanged page is not rasterized nor sent again
+	lcdDisplayListBegin(&pageList);
+	Ui_RenderPage();
+	if(lcdDisplayListEnd())
+	{
+		lcdDisplayListPresent(&pageList);
+	}
+	else
+	{
+		// too large for the list, draw it directly
+		lcdDisplayListInvalidate();
+		lcdBeginFrame();
+		if(!lcdIsFrameDropped())
+		{
+			do
+			{
+				Ui_RenderPage();
+			} while(lcdNextBand());
+		}
+	}
+
+	lcdSelectDisplay(selected);
+}
+
+/**
+ * @brief Grows a rectangle to cover another one, a zero width rectangle is empty.
+ */
+static void Ui_UnionRect(LcdRect *rect, const LcdRect *other)
+{
+	if(other->width <= 0) return;
+	if(rect->width <= 0)
+	{
+		*rect = *other;
+		return;
+	}
+
+	int x1 = rect->x + rect->width;
+	int y1 = rect->y + rect->height;
+	if(other->x + other->width > x1) x1 = other->x + other->width;
+	if(other->y + other->height > y1) y1 = other->y + other->height;
+	if(other->x < rect->x) rect->x = other->x;
+	if(other->y < rect->y) rect->y = other->y;
+	rect->width = x1 - rect->x;
+	rect->height = y1 - rect->y;
+}
+
+/**
+ * @brief Fills a widget area with the page background and limits drawing to it.
+ */
+static void Ui_BeginRepaint(const LcdRect *area)
+{
+	lcdSetClipRect(area->x, area->y, area->width, area->height);
+	lcdFillRectangle(area->x, area->y, area->width, area->height, BACKGROUND_COLOR);
+}
+
+/**
+ * @brief Removes the clipping of Ui_BeginRepaint() and adds the area to the flushed one.
+ * @return Number of repainted pixels.
+ */
+static uint32_t Ui_EndRepaint(const LcdRect *area, LcdRect *flush)
+{
+	lcdResetClipRect();
+	Ui_UnionRect(flush, area);
+	return (uint32_t)area->width * area->height;
+}
+
+/**
+ * @brief Applies the pending scroll of a list and redraws its dirty rows.
+ * @details The rows that stay visible are moved within the framebuffer, only
+ * the exposed and the changed rows are drawn.
+ * @return Number of moved and drawn pixels.
+ */
+static uint32_t Ui_RepaintList(const Ui_List *list, LcdRect *flush)
+{
+	Ui_List_State *state = list->state;
+	LcdRect area = { list->x, list->y, list->width, list->rows * list->rowHeight };
+	uint32_t pixels = 0;
+
+	if(state->scroll != 0)
+	{
+		if(state->scroll < list->rows && -state->scroll < list->rows)
+		{
+			int shift = state->scroll * list->rowHeight;
+			LcdRect kept = area;
+			kept.height -= shift > 0 ? shift : -shift;
+			if(shift > 0)
+			{
+				kept.y += shift;
+			}
+			lcdMoveRegion(&kept, 0, -shift);
+			pixels += (uint32_t)kept.width * kept.height;
+		}
+		state->scroll = 0;
+
+		// every row changed on the panel
+		Ui_UnionRect(flush, &area);
+	}
+
+	for(uint8_t row = 0; row < list->rows; row++)
+	{
+		if(!(state->dirtyRows & (1UL << row))) continue;
+
+		LcdRect rowArea = Ui_DrawListRow(list, row);
+		Ui_UnionRect(flush, &rowArea);
+		pixels += (uint32_t)rowArea.width * rowArea.height;
+	}
+	state->dirtyRows = 0;
+	return pixels;
+}
+
+static void Ui_RepaintDirty()
+{
+	Ui_FinishTransition();
+
+	// the widgets stay dirty until the overlays are hidden
+	if(currentPage == NULL || overlayCount > 0) return;
+
+	LcdDisplay *selected = Ui_SelectPageDisplay();
+
+	if(lcdIsBanded())
+	{
+		// only one band is resident, the widgets may live in any of them
+		Ui_DrawPage();
+		lcdSelectDisplay(selected);
+		return;
+	}
+
+	uint32_t start = Perf_Now();
+	uint32_t pixels = 0;
+	LcdRect flush = { 0, 0, 0, 0 };
+
+	for(size_t i = 0; i < currentPage->label_Dynamic_Count; i++)
+	{
+		const Label_Dynamic *label = currentPage->labels_Dynamic[i];
+		if(!label->state->dirty) continue;
+
+		// the glyph cells are opaque, no background to restore
+		LcdRect area = Ui_DrawLabel_Dynamic(label, 0);
+		Ui_UnionRect(&flush, &area);
+		pixels += (uint32_t)area.width * area.height;
+	}
+
+	for(size_t i = 0; i < currentPage->buttonCount; i++)
+	{
+		const Button *btn = currentPage->buttons[i];
+		if(!(dirtyButtons & (1UL << i))) continue;
+		dirtyButtons &= ~(1UL << i);
+
+		LcdRect area = { btn->x, btn->y, btn->width, btn->height };
+		uint8_t isHighlighted = (i == currentButtonIndex);
+		if(Ui_CacheDraw(btn, isHighlighted, &area))
+		{
+			Ui_UnionRect(&flush, &area);
+			pixels += (uint32_t)area.width * area.height;
+			continue;
+		}
+
+		Ui_BeginRepaint(&area);
+		Ui_DrawButton(btn, isHighlighted);
+		Ui_CacheStore(btn, isHighlighted, &area);
+		pixels += Ui_EndRepaint(&area, &flush);
+	}
+
+	if(currentPage->list != NULL)
+	{
+		pixels += Ui_RepaintList(currentPage->list, &flush);
+	}
+
+	if(pixels > 0)
+	{
+		lcdCopyRect(flush.x, flush.y, flush.width, flush.height);
+
+		// the screen no longer matches the recorded page
+		lcdDisplayListInvalidate();
+		Perf_Record(&uiRepaintPerf, start, pixels);
+	}
+
+	lcdSelectDisplay(selected);
+}
+
+static void Ui_ShowPage(const Page *page, int8_t direction)
+{
+	// the framebuffer of the sliding page is about to be overwritten
+	Ui_FinishTransition();
+
+	const Page *previous = currentPage;
+	Ui_PageState *state = Ui_GetPageState(currentPage);
+	if(state != NULL)
+	{
+		state->focus = currentButtonIndex;
+	}
+
+	currentPage = page;
+	currentButtonIndex = 0;
+	state = Ui_GetPageState(page);
+	if(state != NULL && state->focus < page->buttonCount)
+	{
+		currentButtonIndex = state->focus;
+	}
+
+	// overlays belong to the page they were opened on
+	overlayCount = 0;
+	saveUnderUsed = 0;
+
+	// keep the pipeline statistics specific to the shown page
+	Perf_Reset(&lcdBandRenderPerf);
+	Perf_Reset(&lcdBandTransferPerf);
+	Perf_Reset(&lcdBandStallPerf);
+	Perf_Reset(&lcdFramePerf);
+
+	uint8_t prerendered = Ui_GetPageBackground(page, 0) != NULL;
+	uint64_t decodeCycles = lcdRleDecodePerf.totalCycles;
+
+	if(!Ui_StartTransition(previous, direction))
+	{
+		Ui_DrawPage();
+	}
+
+	if(state == NULL) return;
+	if(prerendered)
+	{
+		uiPrerenderStats.hits++;
+		decodeCycles = lcdRleDecodePerf.totalCycles - decodeCycles;
+		if(state->renderCycles > decodeCycles)
+		{
+			uiPrerenderStats.cyclesSaved += state->renderCycles - decodeCycles;
+		}
+	}
+	else
+	{
+		uiPrerenderStats.misses++;
+	}
+}
+
+void Ui_SetCurrentPage(const Page *newPage)
+{
+	if(newPage == NULL) return;
+
+	navDepth = 0;
+	Ui_ShowPage(newPage, 0);
+}
+
+void Ui_OpenPage(const Page *page)
+{
+	if(page == NULL || page == currentPage) return;
+
+	if(currentPage != NULL)
+	{
+		if(navDepth == UI_NAV_DEPTH)
+		{
+			// forget the oldest page
+			memmove(&navStack[0], &navStack[1], (UI_NAV_DEPTH - 1) * sizeof(navStack[0]));
+			navDepth--;
+		}
+		navStack[navDepth++] = currentPage;
+	}
+	Ui_ShowPage(page, 1);
+}
+
+void Ui_GoBack(const Page *fallback)
+{
+	if(navDepth > 0)
+	{
+		Ui_ShowPage(navStack[--navDepth], -1);
+	}
+	else if(fallback != NULL && fallback != currentPage)
+	{
+		Ui_ShowPage(fallback, -1);
+	}
+}
+
+static uint8_t Ui_StartTransition(const Page *previous, int8_t direction)
+{
+#if UI_TRANSITION_STEPS > 0
+	if(direction == 0 || previous == NULL || previous->display != currentPage->display) return 0;
+
+	uint8_t started = 0;
+	LcdDisplay *selected = Ui_SelectPageDisplay();
+	if(lcdIsReady() && !lcdIsBanded() && lcdGetScrollAxis() != LCD_SCROLL_NONE)
+	{
+		// the panel keeps showing the previous page, only the framebuffer changes
+		Ui_PreparePage();
+		lcdDisplayListInvalidate();
+		Ui_RenderPage();
+
+		transition.direction = direction;
+		transition.shown = 0;
+		started = 1;
+	}
+	lcdSelectDisplay(selected);
+
+	if(started)
+	{
+		Ui_StepTransition(0);
+	}
+	return started;
+#else
+	return 0;
+#endif
+}
+
+static void Ui_StepTransition(uint8_t all)
+{
+#if UI_TRANSITION_STEPS > 0
+	if(transition.direction == 0) return;
+
+	LcdDisplay *selected = Ui_SelectPageDisplay();
+	uint32_t start = Perf_Now();
+
+	uint8_t horizontal = lcdGetScrollAxis() == LCD_SCROLL_HORIZONTAL;
+	int lines = horizontal ? lcdGetWidth() : lcdGetHeight();
+	int across = horizontal ? lcdGetHeight() : lcdGetWidth();
+	int shown = all ? lines : transition.shown + (lines + UI_TRANSITION_STEPS - 1) / UI_TRANSITION_STEPS;
+	if(shown > lines)
+	{
+		shown = lines;
+	}
+
+	// the strip goes to the RAM lines the new offset brings in at the entering
+	// edge, until the offset moves they still show the leaving edge of the
+	// previous page, so both go out in one vertical blanking. At the last
+	// step the RAM holds the whole page at offset 0 again.
+	int first = transition.direction > 0 ? transition.shown : lines - shown;
+	int count = shown - transition.shown;
+	int offset = transition.direction > 0 ? shown : lines - shown;
+	if(all)
+	{
+		// cut to the page, the rest is far too long for one blanking
+		if(horizontal)
+		{
+			lcdCopyRect(first, 0, count, across);
+		}
+		else
+		{
+			lcdCopyRect(0, first, across, count);
+		}
+		lcdSetScrollOffset(offset);
+	}
+	else if(horizontal)
+	{
+		lcdCopyRectAndScroll(first, 0, count, across, offset);
+	}
+	else
+	{
+		lcdCopyRectAndScroll(0, first, across, count, offset);
+	}
+
+	transition.shown = shown;
+	if(shown == lines)
+	{
+		transition.direction = 0;
+	}
+
+	Perf_Record(&uiTransitionPerf, start, (uint32_t)count * across);
+	lcdSelectDisplay(selected);
+#endif
+}
+
+static void Ui_FinishTransition()
+{
+	Ui_StepTransition(1);
+}
+
+/**
+ * @brief Tells whether a page is worth rendering ahead from the current page.
+ */
+static uint8_t Ui_NeedsPrerender(const Page *page)
+{
+	if(page == NULL || page->display != currentPage->display) return 0;
+
+	const Ui_PageState *state = Ui_GetPageState(page);
+	return state != NULL && state->background.size == 0 && !state->noRoom;
+}
+
+/**
+ * @brief Picks the next page to render ahead.
+ * @details The current page comes first, then the target of the highlighted
+ * button, the other targets and the page Ui_GoBack() would return to.
+ * @return The page, NULL when all of them are ready.
+ */
+static const Page* Ui_NextPrerenderPage()
+{
+	if(Ui_NeedsPrerender(currentPage))
+	{
+		return currentPage;
+	}
+
+	if(currentPage->buttonCount > 0 && Ui_NeedsPrerender(currentPage->buttons[currentButtonIndex]->target))
+	{
+		return currentPage->buttons[currentButtonIndex]->target;
+	}
+
+	for(size_t i = 0; i < currentPage->buttonCount; i++)
+	{
+		if(Ui_NeedsPrerender(currentPage->buttons[i]->target))
+		{
+			return currentPage->buttons[i]->target;
+		}
+	}
+
+	if(navDepth > 0 && Ui_NeedsPrerender(navStack[navDepth - 1]))
+	{
+		return navStack[navDepth - 1];
+	}
+	return NULL;
+}
+
+static void Ui_Prerender(uint32_t now)
+{
+#if UI_BACKGROUND_POOL_BYTES > 0
+	if(currentPage == NULL || deferredCount > 0) return;
+	if(now - lastInputTick < UI_PRERENDER_IDLE_MS || overlayCount > 0 || dirtyButtons != 0 || transition.direction != 0) return;
+
+	const Page *page = Ui_NextPrerenderPage();
+	if(page == NULL) return;
+
+	LcdDisplay *selected = Ui_SelectPageDisplay();
+	if(lcdIsReady() && !lcdIsBusy() && !lcdIsBanded() && !lcdIsFrameDropped())
+	{
+		if(Ui_GetPageBackground(page, 1) != NULL)
+		{
+			uiPrerenderStats.prerendered++;
+		}
+
+		// the shown page goes back into the framebuffer, the panel never saw the other one
+		Ui_RenderPage();
+	}
+	lcdSelectDisplay(selected);
+#endif
+}
+
+void Ui_ChangeMenuTheme(const Theme *theme)
+{
+	if(theme == NULL) return;
+
+	// buttons on the other pages pick the new colors up when their page is drawn
+	menuTheme = theme;
+	Ui_CacheInvalidate();
+	Ui_ResetPageBackgrounds();
+
+	if(currentPage == NULL) return;
+
+	for(size_t i = 0; i < currentPage->buttonCount; i++)
+	{
+		if(currentPage->buttons[i]->theme == &menuTheme)
+		{
+			dirtyButtons |= 1UL << i;
+		}
+	}
+	Ui_RepaintDirty();
+}
+
+void Ui_MoveHighlight(uint8_t dirDown)
+{
+    if (currentPage != NULL && currentPage->list != NULL)
+    {
+        Ui_MoveListSelection(currentPage->list, dirDown);
+        Ui_RepaintDirty();
+        return;
+    }
+
+    if (currentPage == NULL || currentPage->buttonCount == 0) return;
+
+    dirtyButtons |= 1UL << currentButtonIndex;
+
+    if (dirDown)
+    {
+        currentButtonIndex++;
+        if (currentButtonIndex >= currentPage->buttonCount)
+            currentButtonIndex = 0;
+    }
+    else
+    {
+        if (currentButtonIndex == 0)
+            currentButtonIndex = currentPage->buttonCount - 1;
+        else
+            currentButtonIndex--;
+    }
+
+    dirtyButtons |= 1UL << currentButtonIndex;
+    Ui_RepaintDirty();
+}
+
+void Ui_UpdateDHTData(float temperature, float humidity)
+{
+    Ui_Publish(&temperatureSource, temperature);
+    Ui_Publish(&humiditySource, humidity);
+
+    uint32_t slot = historyTotal % UI_HISTORY_LENGTH;
+    historyTemperature[slot] = temperature;
+    historyHumidity[slot] = humidity;
+    historyTotal++;
+    Ui_Publish(&historySource, historyTotal);
+}
+
+void Ui_Publish(Ui_Source *source, float value)
+{
+	if(source->version != 0 && source->value == value) return;
+
+	source->value = value;
+	source->version++;
+	if(source->version == 0)
+	{
+		// 0 is reserved for a source never published
+		source->version = 1;
+	}
+}
+
+static void Ui_FormatTemperature(char *text, size_t size, float value)
+{
+	snprintf(text, size, "%.1fC", value);
+}
+
+static void Ui_FormatHumidity(char *text, size_t size, float value)
+{
+	snprintf(text, size, "%.1f%%", value);
+}
+
+static uint32_t Ui_HistoryCount()
+{
+	return historyTotal < UI_HISTORY_LENGTH ? historyTotal : UI_HISTORY_LENGTH;
+}
+
+static void Ui_HistoryItem(uint32_t index, char *text, size_t size)
+{
+	uint32_t reading = historyTotal - Ui_HistoryCount() + index;
+	uint32_t slot = reading % UI_HISTORY_LENGTH;
+	snprintf(text, size, "%lu %.1fC %.0f%%", (unsigned long)reading + 1,
+			 historyTemperature[slot], historyHumidity[slot]);
+}
+
+static uint8_t Ui_UpdateBinding(const Label_Dynamic *label)
+{
+	if(label->source == NULL || label->state->version == label->source->version) return 0;
+
+	label->state->version = label->source->version;
+
+	// small changes often format to the same text, nothing to repaint then
+	char text[UI_LABEL_TEXT_MAX];
+	size_t size = label->dataSize < sizeof(text) ? label->dataSize : sizeof(text);
+	label->format(text, size, label->source->value);
+	if(strcmp(text, label->dataPtr) == 0) return 0;
+
+	strcpy(label->dataPtr, text);
+	return 1;
+}
+
+void Ui_Idle()
+{
+	// the UI interrupts that came before have finished drawing, the ones
+	// that come from here on defer to this function
+	idleDrawing = 1;
+	__COMPILER_BARRIER();
+
+	Ui_HandleDeferredInputs();
+	if(frameDue)
+	{
+		frameDue = 0;
+		Ui_DrawFrame(HAL_GetTick());
+	}
+	Ui_Prerender(HAL_GetTick());
+
+	__COMPILER_BARRIER();
+	idleDrawing = 0;
+}
+
+static uint8_t Ui_DeferInput(Ui_Input input)
+{
+	if(!idleDrawing && deferredCount == 0) return 0;
+
+	lastInputTick = HAL_GetTick();
+	if(deferredCount < UI_DEFERRED_INPUTS)
+	{
+		deferredInputs[deferredCount++] = input;
+	}
+	return 1;
+}
+
+static void Ui_HandleDeferredInputs()
+{
+	while(deferredCount > 0)
+	{
+		// the interrupts keep adding events meanwhile
+		uint8_t inputs[UI_DEFERRED_INPUTS];
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		uint8_t count = deferredCount;
+		for(uint8_t i = 0; i < count; i++)
+		{
+			inputs[i] = deferredInputs[i];
+		}
+		deferredCount = 0;
+		__set_PRIMASK(primask);
+
+		for(uint8_t i = 0; i < count; i++)
+		{
+			switch(inputs[i])
+			{
+			case UI_INPUT_SHORT_PRESS: Ui_HandleShortPress(); break;
+			case UI_INPUT_LONG_PRESS:  Ui_HandleLongPress(); break;
+			case UI_INPUT_MOVE_UP:     Ui_HandleMove(0); break;
+			case UI_INPUT_MOVE_DOWN:   Ui_HandleMove(1); break;
+			}
+		}
+	}
+}
+
+void Ui_Process()
+{
+	uint32_t now = HAL_GetTick();
+	if(now - lastFrameTick < UI_FRAME_PERIOD_MS) return;
+	lastFrameTick = now;
+	frameDue = 1;
+}
+
+static void Ui_DrawFrame(uint32_t now)
+{
+	if(currentPage == NULL) return;
+
+	LcdDisplay *selected = Ui_SelectPageDisplay();
+	uint8_t dropped = lcdIsFrameDropped() && lcdIsReady();
+	lcdSelectDisplay(selected);
+	if(dropped)
+	{
+		// the page was drawn while the display was coming up or asleep, it never reached the panel
+		Ui_DrawPage();
+		return;
+	}
+
+	if(transition.direction != 0)
+	{
+		// the labels catch up once the page is in place
+		Ui_StepTransition(0);
+		return;
+	}
+
+	const Ui_Overlay *overlay = Ui_GetOverlay();
+	if(overlay != NULL && overlay->timeoutMs != 0 &&
+	   now - overlayStack[overlayCount - 1].shownTick >= overlay->timeoutMs)
+	{
+		Ui_HideOverlay();
+	}
+
+	uint8_t changed = 0;
+	for(size_t i = 0; i < currentPage->label_Dynamic_Count; i++)
+	{
+		const Label_Dynamic *label = currentPage->labels_Dynamic[i];
+		if(Ui_UpdateBinding(label))
+		{
+			label->state->dirty = 1;
+			changed = 1;
+		}
+	}
+
+	const Ui_List *list = currentPage->list;
+	if(list != NULL && list->source != NULL && list->state->version != list->source->version)
+	{
+		Ui_SyncList(list);
+		changed = 1;
+	}
+
+	if(changed)
+	{
+		Ui_RepaintDirty();
+	}
+}
+
+static void Ui_DrawOverlay(const Ui_Overlay *overlay)
+{
+	// the frame is filled, lcdDrawRoundRectangle() would reach past the saved area
+	lcdFillRoundRectangle(overlay->x, overlay->y, overlay->width, overlay->height,
+						  UI_OVERLAY_RADIUS, overlay->textColor);
+	lcdFillRoundRectangle(overlay->x + 1, overlay->y + 1, overlay->width - 2, overlay->height - 2,
+						  UI_OVERLAY_RADIUS - 1, overlay->bgColor);
+
+	int centerY = overlay->y + overlay->height / 2;
+	int messageY = centerY - FONT_HEIGHT / 2;
+	if(overlay->title != NULL)
+	{
+		lcdDrawText(overlay->x + (overlay->width - (FONT_WIDTH + 1) * (int)strlen(overlay->title)) / 2,
+					centerY - FONT_HEIGHT - 2,
+					overlay->title,
+					overlay->textColor,
+					overlay->bgColor);
+		messageY = centerY + 2;
+	}
+	lcdDrawText(overlay->x + (overlay->width - (FONT_WIDTH + 1) * (int)strlen(overlay->message)) / 2,
+				messageY,
+				overlay->message,
+				overlay->textColor,
+				overlay->bgColor);
+}
+
+void Ui_ShowOverlay(const Ui_Overlay *overlay)
+{
+	if(overlay == NULL || currentPage == NULL) return;
+	if(Ui_GetOverlay() != overlay && overlayCount == UI_OVERLAY_DEPTH) return;
+
+	Ui_FinishTransition();
+	LcdDisplay *selected = Ui_SelectPageDisplay();
+
+	if(Ui_GetOverlay() == overlay)
+	{
+		// already on top, only its text may have changed
+		overlayStack[overlayCount - 1].shownTick = HAL_GetTick();
+	}
+	else
+	{
+		Ui_OverlaySlot *slot = &overlayStack[overlayCount++];
+		slot->overlay = overlay;
+		slot->saved = NULL;
+		slot->shownTick = HAL_GetTick();
+
+		uint32_t pixels = (uint32_t)overlay->width * overlay->height;
+		if(!lcdIsBanded() && saveUnderUsed + pixels <= UI_OVERLAY_SAVE_PIXELS)
+		{
+			slot->saved = &saveUnderPool[saveUnderUsed];
+			saveUnderUsed += pixels;
+			LcdRect area = { overlay->x, overlay->y, overlay->width, overlay->height };
+			lcdReadRegion(&area, slot->saved);
+		}
+	}
+
+	if(lcdIsBanded())
+	{
+		// only one band is resident, the overlays are drawn with the page
+		Ui_DrawPage();
+	}
+	else
+	{
+		Ui_DrawOverlay(overlay);
+		lcdCopyRect(overlay->x, overlay->y, overlay->width, overlay->height);
+
+		// the screen no longer matches the recorded page
+		lcdDisplayListInvalidate();
+	}
+	lcdSelectDisplay(selected);
+}
+
+void Ui_HideOverlay()
+{
+	if(overlayCount == 0) return;
+
+	LcdDisplay *selected = Ui_SelectPageDisplay();
+	const Ui_OverlaySlot *slot = &overlayStack[--overlayCount];
+	const Ui_Overlay *overlay = slot->overlay;
+
+	if(slot->saved != NULL && !lcdIsBanded())
+	{
+		LcdBitmap beneath = {
+				.pixels = slot->saved,
+				.width = overlay->width,
+				.height = overlay->height,
+		};
+		lcdDrawBitmap(&beneath, overlay->x, overlay->y);
+		lcdCopyRect(overlay->x, overlay->y, overlay->width, overlay->height);
+		lcdDisplayListInvalidate();
+		saveUnderUsed = slot->saved - saveUnderPool;
+	}
+	else
+	{
+		// nothing to restore from, the page and the overlays left are drawn again
+		Ui_DrawPage();
+	}
+
+	if(overlayCount == 0)
+	{
+		saveUnderUsed = 0;
+
+		// changes made while the page was covered
+		Ui_RepaintDirty();
+	}
+	lcdSelectDisplay(selected);
+}
+
+const Ui_Overlay* Ui_GetOverlay()
+{
+	return overlayCount > 0 ? overlayStack[overlayCount - 1].overlay : NULL;
+}
+
+static uint8_t Ui_RouteToOverlay(uint8_t press, uint8_t confirm)
+{
+	const Ui_Overlay *overlay;
+
+	// toasts never keep the input
+	while((overlay = Ui_GetOverlay()) != NULL && overlay->timeoutMs != 0)
+	{
+		Ui_HideOverlay();
+	}
+	if(overlay == NULL) return 0;
+
+	if(press)
+	{
+		Ui_HideOverlay();
+		if(confirm && overlay->onConfirm != NULL)
+		{
+			overlay->onConfirm(overlay);
+		}
+	}
+	return 1;
+}
+
+void Ui_FSM_ShortPressActionDetected()
+{
+	if(Ui_DeferInput(UI_INPUT_SHORT_PRESS)) return;
+	Ui_HandleShortPress();
+}
+
+void Ui_FSM_LongPressActionDetected()
+{
+	if(Ui_DeferInput(UI_INPUT_LONG_PRESS)) return;
+	Ui_HandleLongPress();
+}
+
+void Ui_MoveActionDetected(uint8_t dirDown)
+{
+	if(Ui_DeferInput(dirDown ? UI_INPUT_MOVE_DOWN : UI_INPUT_MOVE_UP)) return;
+	Ui_HandleMove(dirDown);
+}
+
+static void Ui_HandleShortPress()
+{
+	lastInputTick = HAL_GetTick();
+	if(Ui_RouteToOverlay(1, 1)) return;
+
+	const Ui_List *list = currentPage != NULL ? currentPage->list : NULL;
+	if(list != NULL)
+	{
+		// the buttons of a list page are clicked by a long press
+		if(list->onSelect != NULL && list->state->count > 0)
+		{
+			list->onSelect(list, list->state->selected);
+		}
+		return;
+	}
+
+	Ui_ExecuteAction();
+}
+
+static void Ui_HandleLongPress()
+{
+	lastInputTick = HAL_GetTick();
+	if(Ui_RouteToOverlay(1, 0)) return;
+
+	Ui_ExecuteAction();
+}
+
+static void Ui_HandleMove(uint8_t dirDown)
+{
+	lastInputTick = HAL_GetTick();
+	if(Ui_RouteToOverlay(0, 0)) return;
+
 	Ui_MoveHighlight(dirDown);
 }
 
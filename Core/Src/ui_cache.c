@@ -0,0 +1,155 @@
+/*
+ * ui_cache.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ */
+#include "ui_cache.h"
+#include "lcd_blit.h"
+
+Ui_CacheStats uiCacheStats = {
+		.poolBytes = (UI_CACHE_SLOTS * UI_CACHE_SLOT_PIXELS + UI_CACHE_SMALL_SLOTS * UI_CACHE_SMALL_SLOT_PIXELS) * sizeof(uint16_t),
+};
+
+#if UI_CACHE_ENTRIES > 0
+
+/**
+ * @brief One cached widget image.
+ */
+typedef struct {
+	const void *widget;   ///< Widget the image belongs to, NULL for a free slot.
+	uint8_t state;        ///< Visual state the image shows.
+	LcdBitmap bitmap;     ///< Image, its pixels point into the pool.
+	uint32_t lastUse;     ///< Value of useCounter at the last hit or store.
+} Ui_CacheEntry;
+
+/// @brief Pixels of the large slots followed by the small ones.
+static uint16_t pool[UI_CACHE_SLOTS * UI_CACHE_SLOT_PIXELS + UI_CACHE_SMALL_SLOTS * UI_CACHE_SMALL_SLOT_PIXELS];
+/// @brief Large slots first, then the small ones.
+static Ui_CacheEntry entries[UI_CACHE_ENTRIES];
+static uint32_t useCounter = 0;
+
+/**
+ * @brief Gives the pixel memory of the slot of an entry.
+ */
+static uint16_t* Ui_CacheSlotPixels(int index)
+{
+	if(index < UI_CACHE_SLOTS)
+	{
+		return &pool[index * UI_CACHE_SLOT_PIXELS];
+	}
+	return &pool[UI_CACHE_SLOTS * UI_CACHE_SLOT_PIXELS + (index - UI_CACHE_SLOTS) * UI_CACHE_SMALL_SLOT_PIXELS];
+}
+
+/**
+ * @brief Finds the image of a widget state.
+ * @return The entry, NULL if not cached.
+ */
+static Ui_CacheEntry* Ui_CacheFind(const void *widget, uint8_t state, const LcdRect *area)
+{
+	for(int i = 0; i < UI_CACHE_ENTRIES; i++)
+	{
+		Ui_CacheEntry *entry = &entries[i];
+		if(entry->widget == widget && entry->state == state &&
+		   entry->bitmap.width == area->width && entry->bitmap.height == area->height)
+		{
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+uint8_t Ui_CacheDraw(const void *widget, uint8_t state, const LcdRect *area)
+{
+	Ui_CacheEntry *entry = Ui_CacheFind(widget, state, area);
+	if(entry == NULL)
+	{
+		uiCacheStats.misses++;
+		return 0;
+	}
+
+	entry->lastUse = ++useCounter;
+	uiCacheStats.hits++;
+	lcdDrawBitmap(&entry->bitmap, area->x, area->y);
+	return 1;
+}
+
+void Ui_CacheStore(const void *widget, uint8_t state, const LcdRect *area)
+{
+	int pixelCount = area->width * area->height;
+	if(area->width <= 0 || area->height <= 0) return;
+	if(Ui_CacheFind(widget, state, area) != NULL) return;
+
+	// the smallest slots the widget fits in
+	int first, last;
+	if(UI_CACHE_SMALL_SLOTS > 0 && pixelCount <= UI_CACHE_SMALL_SLOT_PIXELS)
+	{
+		first = UI_CACHE_SLOTS;
+		last = UI_CACHE_ENTRIES;
+	}
+	else if(UI_CACHE_SLOTS > 0 && pixelCount <= UI_CACHE_SLOT_PIXELS)
+	{
+		first = 0;
+		last = UI_CACHE_SLOTS;
+	}
+	else
+	{
+		return;
+	}
+
+	// a free slot, or the least recently used one
+	Ui_CacheEntry *victim = &entries[first];
+	for(int i = first; i < last && victim->widget != NULL; i++)
+	{
+		if(entries[i].widget == NULL || entries[i].lastUse < victim->lastUse)
+		{
+			victim = &entries[i];
+		}
+	}
+
+	if(victim->widget != NULL)
+	{
+		uiCacheStats.evictions++;
+		uiCacheStats.usedBytes -= victim->bitmap.width * victim->bitmap.height * sizeof(uint16_t);
+	}
+
+	uint16_t *pixels = Ui_CacheSlotPixels(victim - entries);
+	lcdReadRegion(area, pixels);
+
+	victim->widget = widget;
+	victim->state = state;
+	victim->bitmap.pixels = pixels;
+	victim->bitmap.width = area->width;
+	victim->bitmap.height = area->height;
+	victim->bitmap.useColorKey = 0;
+	victim->lastUse = ++useCounter;
+	uiCacheStats.usedBytes += area->width * area->height * sizeof(uint16_t);
+}
+
+void Ui_CacheInvalidate()
+{
+	for(int i = 0; i < UI_CACHE_ENTRIES; i++)
+	{
+		entries[i].widget = NULL;
+	}
+	uiCacheStats.usedBytes = 0;
+	uiCacheStats.flushes++;
+}
+
+#else
+
+uint8_t Ui_CacheDraw(const void *widget, uint8_t state, const LcdRect *area)
+{
+	uiCacheStats.misses++;
+	return 0;
+}
+
+void Ui_CacheStore(const void *widget, uint8_t state, const LcdRect *area)
+{
+}
+
+void Ui_CacheInvalidate()
+{
+}
+
+#endif
@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Builds the display and UI modules for the host (gcc, no board needed) and
+# runs the tests of this folder, or the ones given as arguments.
+#   Tools/host/run.sh [Tools/host/test_slide.c ...]
+# The display list packs pointers in 32 bits, the tests link without PIE to
+# keep the images below 4 GiB.
+# Exits non-zero when a test fails.
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+build=$(mktemp -d)
+trap 'rm -rf "$build"' EXIT
+
+# the stand-ins replace the board headers of Core/Inc, which would be found
+# first next to the headers including them
+mkdir -p "$build/inc"
+for header in "$root"/Core/Inc/*.h; do
+	[ -e "$here/stub/$(basename "$header")" ] || cp "$header" "$build/inc/"
+done
+
+sources="lcd.c lcd_stream.c lcd_panel.c lcd_dlist.c font.c lcd_rotozoom.c lcd_blit.c lcd_gradient.c lcd_rle.c ui.c ui_cache.c"
+files="$here/stub/host_hal.c"
+for source in $sources; do
+	files="$files $root/Core/Src/$source"
+done
+
+tests=${*:-$here/test_*.c}
+failed=0
+for test in $tests; do
+	name=$(basename "$test" .c)
+	if ! gcc -std=gnu11 -O1 -g -no-pie -w -I"$here/stub" -I"$build/inc" \
+			"$test" $files -o "$build/$name"; then
+		echo "$name: build failed"
+		failed=1
+		continue
+	fi
+	echo "== $name"
+	"$build/$name" || failed=1
+done
+exit $failed
@@ -0,0 +1,243 @@
+/*
+ * host_hal.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Host stand-in for the HAL: the SPI bytes and commands are logged, DMA
+ *  transfers complete when a test calls Host_CompleteDma(), tearing
+ *  effect events come from Host_Vsync() or, with hostTeWired, whenever
+ *  the driver polls the EXTI line.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "host_hal.h"
+#include "spi.h"
+#include "lcd.h"
+
+GPIO_TypeDef hostGpio;
+SPI_TypeDef hostSpi2;
+static DMA_Stream_TypeDef stream;
+DMA_HandleTypeDef hdma_spi2_tx = { &stream };
+SPI_HandleTypeDef hspi2 = { &hostSpi2, &hdma_spi2_tx };
+
+uint32_t SystemCoreClock = 84000000U;
+uint32_t hostCycles;
+uint32_t hostTick;
+void (*hostTickHook)(void);
+uint8_t hostTeWired;
+
+uint8_t hostSink[HOST_SINK_BYTES];
+uint32_t hostSinkBytes;
+uint16_t hostCommands[HOST_LOG_LENGTH];
+int hostCommandCount;
+
+static uint8_t dataMode = 1;
+static uint8_t dmaPending;
+static const uint8_t *dmaData;
+static uint32_t dmaBytes;
+static uint8_t *dbmAddress[2];
+static uint32_t dbmLength;
+static uint8_t dbmRunning, dbmAborted;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state)
+{
+	if(pin == LCD_DC_Pin) dataMode = state;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size, uint32_t timeout)
+{
+	if(dmaPending) return HAL_BUSY;
+	for(uint16_t i = 0; i < size; i++)
+	{
+		if(hostCommandCount < HOST_LOG_LENGTH)
+		{
+			hostCommands[hostCommandCount++] = data[i] | (dataMode ? 0 : HOST_COMMAND);
+		}
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size)
+{
+	if(dmaPending || dbmRunning) return HAL_BUSY;
+	dmaPending = 1;
+	dmaData = data;
+	dmaBytes = size * (hspi->Init.DataSize ? 2U : 1U);
+	hspi->hdmatx->Instance->NDTR = size;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMAEx_MultiBufferStart_IT(DMA_HandleTypeDef *hdma, uint32_t src, uint32_t dst, uint32_t second, uint32_t length)
+{
+	if(dmaPending || dbmRunning) return HAL_BUSY;
+	dbmAddress[0] = (uint8_t*)(uintptr_t)src;
+	dbmAddress[1] = (uint8_t*)(uintptr_t)second;
+	dbmLength = length;
+	dbmRunning = 1;
+	dbmAborted = 0;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMAEx_ChangeMemory(DMA_HandleTypeDef *hdma, uint32_t address, HAL_DMA_MemoryTypeDef memory)
+{
+	dbmAddress[memory] = (uint8_t*)(uintptr_t)address;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+	dbmAborted = 1;
+	return HAL_OK;
+}
+
+/**
+ * @brief Copies 16 bit words to the sink in bus order (high byte first).
+ */
+static void Host_Sink(const uint8_t *data, uint32_t bytes)
+{
+	for(uint32_t i = 0; i + 1 < bytes && hostSinkBytes + 2 <= HOST_SINK_BYTES; i += 2)
+	{
+		hostSink[hostSinkBytes++] = data[i + 1];
+		hostSink[hostSinkBytes++] = data[i];
+	}
+}
+
+/**
+ * @brief Runs a double buffered stream to its end, the callbacks refill the buffers.
+ */
+static void Host_RunDoubleBuffer()
+{
+	uint8_t target = 0;
+	while(dbmRunning)
+	{
+		Host_Sink(dbmAddress[target], dbmLength * 2);
+		hdma_spi2_tx.Instance->NDTR = dbmLength;
+		dbmAborted = 0;
+		dbmRunning = 0;
+		if(target == 0) hdma_spi2_tx.XferCpltCallback(&hdma_spi2_tx);
+		else hdma_spi2_tx.XferM1CpltCallback(&hdma_spi2_tx);
+		if(dbmAborted) return;
+		dbmRunning = 1;
+		target ^= 1;
+	}
+}
+
+void Host_CompleteDma()
+{
+	if(dbmRunning)
+	{
+		Host_RunDoubleBuffer();
+		return;
+	}
+	if(!dmaPending) return;
+
+	Host_Sink(dmaData, dmaBytes);
+	dmaPending = 0;
+	lcdTransferCompleteCallback(&hspi2);
+}
+
+uint8_t Host_IsDmaPending()
+{
+	return dmaPending || dbmRunning;
+}
+
+void Host_Vsync()
+{
+	lcdTearingEffectCallback(LCD_TE_Pin);
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+	Host_CompleteDma();
+}
+
+int Host_ExtiPending(uint16_t pin)
+{
+	if(hostTeWired) return 1;
+
+	// time passes while the driver waits for an event that never comes
+	hostCycles += SystemCoreClock / 10000U;
+	return 0;
+}
+
+void HAL_GPIO_EXTI_IRQHandler(uint16_t pin)
+{
+	lcdTearingEffectCallback(pin);
+}
+
+uint32_t HAL_GetTick(void)
+{
+	if(hostTickHook != NULL)
+	{
+		// an interrupt preempting the caller, see Tools/host/test_idle.c
+		void (*hook)(void) = hostTickHook;
+		hostTickHook = NULL;
+		hook();
+	}
+	return hostTick;
+}
+
+void HAL_Delay(uint32_t ms)
+{
+	hostTick += ms;
+}
+
+void Error_Handler(void)
+{
+}
+
+void HW_setBacklightBrightness(uint8_t percentage)
+{
+}
+
+void Uart_sendPcState(uint8_t state)
+{
+}
+
+int Host_CommandAt(int from, uint8_t command)
+{
+	for(int i = from; i < hostCommandCount; i++)
+	{
+		if(hostCommands[i] == (HOST_COMMAND | command)) return i;
+	}
+	return -1;
+}
+
+int hostFailures;
+
+void Host_BringUp()
+{
+	lcdInitStart();
+	while(!lcdIsReady())
+	{
+		hostTick++;
+		lcdProcess();
+		Host_CompleteDma();
+	}
+	Host_Drain();
+}
+
+void Host_Drain()
+{
+	for(int i = 0; i < 1000 && lcdIsBusy(); i++)
+	{
+		if(Host_IsDmaPending())
+		{
+			Host_CompleteDma();
+		}
+		else
+		{
+			// an armed flush
+			Host_Vsync();
+		}
+	}
+}
+
+void Host_Check(int passed, const char *text, const char *file, int line)
+{
+	if(passed) return;
+	hostFailures++;
+	printf("%s:%d: check failed: %s\n", file, line, text);
+}
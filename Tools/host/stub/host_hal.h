@@ -0,0 +1,68 @@
+/*
+ * host_hal.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Controls of the host stand-in for the HAL, used by the tests.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+#define HOST_SINK_BYTES   (1 << 20)
+#define HOST_LOG_LENGTH   8192
+#define HOST_COMMAND      0x100U  ///< Flag of a logged byte sent with D/C low.
+
+extern uint32_t hostCycles;
+extern uint32_t hostTick;          ///< HAL tick, only moved by the tests.
+extern void (*hostTickHook)(void); ///< Called once by the next HAL_GetTick().
+extern uint8_t hostTeWired;        ///< The EXTI line reports a pending TE event whenever polled.
+
+extern uint8_t hostSink[HOST_SINK_BYTES];  ///< Pixel bytes sent by DMA.
+extern uint32_t hostSinkBytes;
+extern uint16_t hostCommands[HOST_LOG_LENGTH]; ///< Bytes sent by blocking writes.
+extern int hostCommandCount;
+
+/**
+ * @brief Finishes the running DMA transfer and calls the completion callback.
+ */
+void Host_CompleteDma();
+
+/**
+ * @brief Tells whether a DMA transfer waits for Host_CompleteDma().
+ */
+uint8_t Host_IsDmaPending();
+
+/**
+ * @brief Delivers a tearing effect event.
+ */
+void Host_Vsync();
+
+/**
+ * @brief Index of the first command byte logged at or after @p from, -1 if none.
+ */
+int Host_CommandAt(int from, uint8_t command);
+
+/**
+ * @brief Runs the bring-up of the selected display to the end.
+ */
+void Host_BringUp();
+
+/**
+ * @brief Delivers DMA completions and TE events until nothing is pending.
+ */
+void Host_Drain();
+
+/**
+ * @brief Checks a condition of a test, a failed one is printed and counted.
+ */
+#define HOST_CHECK(condition) Host_Check((condition), #condition, __FILE__, __LINE__)
+void Host_Check(int passed, const char *text, const char *file, int line);
+
+/**
+ * @brief Number of failed HOST_CHECK() conditions, the exit code of a test.
+ */
+extern int hostFailures;
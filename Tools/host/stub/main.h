@@ -0,0 +1,22 @@
+/*
+ * main.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Host stand-in for the pin definitions of the board.
+ */
+
+#pragma once
+
+#include "stm32f4xx_hal.h"
+
+#define LCD_DC_Pin          0x0100U
+#define LCD_DC_GPIO_Port    GPIOA
+#define LCD_RST_Pin         0x0200U
+#define LCD_RST_GPIO_Port   GPIOA
+#define LCD_CS_Pin          0x0400U
+#define LCD_CS_GPIO_Port    GPIOA
+#define LCD_TE_Pin          0x0010U
+
+void Error_Handler(void);
@@ -0,0 +1,38 @@
+/*
+ * perf.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Host stand-in for the DWT instrumentation, the cycle counter is
+ *  hostCycles and only advances when a test moves it.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+typedef struct {
+	uint32_t calls;
+	uint32_t lastCycles;
+	uint32_t maxCycles;
+	uint64_t totalCycles;
+	uint64_t totalItems;
+} Perf_Counter;
+
+extern uint32_t hostCycles;
+
+static inline uint32_t Perf_Now() { return hostCycles; }
+
+static inline void Perf_Record(Perf_Counter *counter, uint32_t startCycles, uint32_t items)
+{
+	counter->calls++;
+	counter->lastCycles = hostCycles - startCycles;
+	counter->totalItems += items;
+}
+
+static inline void Perf_Reset(Perf_Counter *counter)
+{
+	*counter = (Perf_Counter){ 0 };
+}
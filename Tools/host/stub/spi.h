@@ -0,0 +1,6 @@
+#pragma once
+
+#include "main.h"
+
+extern SPI_HandleTypeDef hspi2;
+extern DMA_HandleTypeDef hdma_spi2_tx;
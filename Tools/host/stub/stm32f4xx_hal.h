@@ -0,0 +1,87 @@
+/*
+ * stm32f4xx_hal.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Host stand-in for the parts of the HAL and CMSIS the display and UI
+ *  modules use. Interrupts never preempt on the host, code runs as if it
+ *  was inside a handler (IPSR != 0).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum { HAL_OK, HAL_ERROR, HAL_BUSY } HAL_StatusTypeDef;
+typedef enum { GPIO_PIN_RESET, GPIO_PIN_SET } GPIO_PinState;
+typedef struct { int unused; } GPIO_TypeDef;
+
+typedef struct { volatile uint32_t CR, NDTR, PAR, M0AR, M1AR, FCR; } DMA_Stream_TypeDef;
+typedef enum { MEMORY0, MEMORY1 } HAL_DMA_MemoryTypeDef;
+typedef struct __DMA_HandleTypeDef {
+	DMA_Stream_TypeDef *Instance;
+	void (*XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+	void (*XferM1CpltCallback)(struct __DMA_HandleTypeDef *hdma);
+	void (*XferErrorCallback)(struct __DMA_HandleTypeDef *hdma);
+	void (*XferHalfCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+	void (*XferM1HalfCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+} DMA_HandleTypeDef;
+
+typedef struct { volatile uint32_t CR1, CR2, SR, DR; } SPI_TypeDef;
+typedef struct { uint32_t DataSize; } SPI_InitTypeDef;
+typedef struct { SPI_TypeDef *Instance; DMA_HandleTypeDef *hdmatx; SPI_InitTypeDef Init; } SPI_HandleTypeDef;
+
+#define SET_BIT(reg, bit)               ((reg) |= (bit))
+#define CLEAR_BIT(reg, bit)             ((reg) &= ~(bit))
+#define MODIFY_REG(reg, clear, set)     ((reg) = ((reg) & ~(clear)) | (set))
+
+#define SPI_CR1_DFF         0x800U
+#define SPI_CR1_BR_Pos      3
+#define SPI_CR1_BR          (7U << SPI_CR1_BR_Pos)
+#define SPI_CR2_TXDMAEN     0x2U
+#define SPI_DATASIZE_8BIT   0U
+#define SPI_DATASIZE_16BIT  SPI_CR1_DFF
+#define SPI_FLAG_TXE        0x2U
+#define SPI_FLAG_BSY        0x80U
+#define __HAL_SPI_ENABLE(h)         ((h)->Instance->CR1 |= 0x40U)
+#define __HAL_SPI_DISABLE(h)        ((h)->Instance->CR1 &= ~0x40U)
+#define __HAL_SPI_GET_FLAG(h, f)    ((f) == SPI_FLAG_TXE)
+
+extern SPI_TypeDef hostSpi2;
+#define SPI2 (&hostSpi2)
+#define SPI3 ((SPI_TypeDef*)0)
+
+extern GPIO_TypeDef hostGpio;
+#define GPIOA (&hostGpio)
+
+#define HAL_MAX_DELAY   0xFFFFFFFFU
+#define FLASH_BASE      0x08000000UL
+#define FLASH_END       0x0807FFFFUL
+
+extern uint32_t SystemCoreClock;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_DMAEx_MultiBufferStart_IT(DMA_HandleTypeDef *hdma, uint32_t src, uint32_t dst, uint32_t second, uint32_t length);
+HAL_StatusTypeDef HAL_DMAEx_ChangeMemory(DMA_HandleTypeDef *hdma, uint32_t address, HAL_DMA_MemoryTypeDef memory);
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+void HAL_GPIO_EXTI_IRQHandler(uint16_t pin);
+int Host_ExtiPending(uint16_t pin);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t ms);
+
+static inline uint32_t HAL_RCC_GetPCLK1Freq(void) { return 42000000U; }
+static inline uint32_t HAL_RCC_GetPCLK2Freq(void) { return 84000000U; }
+
+#define __HAL_GPIO_EXTI_GET_IT(pin) Host_ExtiPending(pin)
+#define __COMPILER_BARRIER()        __asm volatile("" ::: "memory")
+
+static inline uint32_t __get_IPSR(void) { return 1U; }
+static inline uint32_t __get_PRIMASK(void) { return 0U; }
+static inline void __set_PRIMASK(uint32_t mask) { (void)mask; }
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <stdint.h>
+
+void Uart_sendPcState(uint8_t state);
@@ -0,0 +1,75 @@
+/*
+ * test_cache.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Moves the highlight around the home and settings pages and checks that
+ *  the widget cache serves most repaints, and that a repaint from the cache
+ *  leaves the same frame as drawing the page from scratch.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "host_hal.h"
+#include "ui.h"
+#include "ui_cache.h"
+#include "lcd_dlist.h"
+#include "lcd_internal.h"
+
+extern const Page homePage, settingsPage;
+
+static uint16_t cached[160 * 128];
+
+/**
+ * @brief Moves the highlight @p moves times, compares every frame with a full redraw.
+ * @param pattern Directions of the moves, bit i set moves the i-th one down, all down if 0.
+ * @return Number of frames that differ.
+ */
+static int Moves(int moves, uint32_t pattern)
+{
+	const uint16_t *fb = lcdGetFrameBuffer();
+	int differing = 0;
+	for(int i = 0; i < moves; i++)
+	{
+		Ui_MoveHighlight(pattern == 0 || (pattern >> (i % 32)) & 1);
+		Host_Drain();
+		memcpy(cached, fb, sizeof cached);
+
+		lcdDisplayListInvalidate();
+		Ui_DrawPage();
+		Host_Drain();
+		differing += memcmp(cached, fb, sizeof cached) != 0;
+	}
+	return differing;
+}
+
+int main()
+{
+	Host_BringUp();
+	Ui_SetCurrentPage(&homePage);
+	Host_Drain();
+
+	// four moves down and three up, over and over
+	uint32_t pattern = 0;
+	for(int i = 0; i < 32; i++) pattern |= (uint32_t)(i % 7 < 4) << i;
+	uint32_t hits = uiCacheStats.hits, misses = uiCacheStats.misses;
+	int differing = Moves(20, pattern);
+	printf("home: differing %d hits %u misses %u\n", differing,
+		   (unsigned)(uiCacheStats.hits - hits), (unsigned)(uiCacheStats.misses - misses));
+	HOST_CHECK(differing == 0);
+	HOST_CHECK(uiCacheStats.hits - hits > uiCacheStats.misses - misses);
+
+	// the return button of the settings page needs a small slot
+	Ui_SetCurrentPage(&settingsPage);
+	Host_Drain();
+	hits = uiCacheStats.hits;
+	misses = uiCacheStats.misses;
+	differing = Moves(20, 0);
+	printf("settings: differing %d hits %u misses %u\n", differing,
+		   (unsigned)(uiCacheStats.hits - hits), (unsigned)(uiCacheStats.misses - misses));
+	HOST_CHECK(differing == 0);
+	HOST_CHECK(uiCacheStats.hits - hits > uiCacheStats.misses - misses);
+
+	return hostFailures;
+}
@@ -0,0 +1,91 @@
+/*
+ * test_idle.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Renders pages ahead with Ui_Idle() and checks that the frame shown is
+ *  restored afterwards, that input arriving from an interrupt while
+ *  Ui_Idle() draws is kept for the next call, and that Ui_Process() in the
+ *  SysTick handler leaves the drawing to Ui_Idle().
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "host_hal.h"
+#include "ui.h"
+#include "lcd_internal.h"
+
+extern const Page homePage, sensorsPage;
+
+static uint16_t shown[160 * 128], moved[160 * 128];
+static int interrupts;
+
+/**
+ * @brief Encoder interrupt firing in the middle of Ui_Idle().
+ */
+static void Interrupt()
+{
+	interrupts++;
+	Ui_MoveActionDetected(1);
+	Ui_Process();
+}
+
+int main()
+{
+	Host_BringUp();
+	Ui_SetCurrentPage(&homePage);
+	Host_Drain();
+	const uint16_t *fb = lcdGetFrameBuffer();
+
+	Ui_MoveActionDetected(1);
+	Host_Drain();
+	memcpy(moved, fb, sizeof moved);
+	Ui_MoveActionDetected(0);
+	Host_Drain();
+	memcpy(shown, fb, sizeof shown);
+
+	// idle long enough, a page is rendered ahead
+	hostTick += 1000;
+	Ui_Idle();
+	Host_Drain();
+	uint32_t prerendered = uiPrerenderStats.prerendered;
+	printf("prerendered %u restored %d\n", (unsigned)prerendered, memcmp(shown, fb, sizeof shown) == 0);
+	HOST_CHECK(prerendered == 1);
+	HOST_CHECK(memcmp(shown, fb, sizeof shown) == 0);
+
+	// the first HAL_GetTick() of Ui_Idle() lets the interrupt in
+	hostTick += 1000;
+	hostTickHook = Interrupt;
+	Ui_Idle();
+	Host_Drain();
+	printf("interrupts %d prerendered %u restored %d\n", interrupts,
+		   (unsigned)uiPrerenderStats.prerendered, memcmp(shown, fb, sizeof shown) == 0);
+	HOST_CHECK(interrupts == 1);
+	HOST_CHECK(memcmp(shown, fb, sizeof shown) == 0);
+
+	// the kept input is handled first, nothing is rendered ahead right after it
+	prerendered = uiPrerenderStats.prerendered;
+	Ui_Idle();
+	Host_Drain();
+	printf("input handled %d\n", memcmp(moved, fb, sizeof moved) == 0);
+	HOST_CHECK(memcmp(moved, fb, sizeof moved) == 0);
+	HOST_CHECK(uiPrerenderStats.prerendered == prerendered);
+
+	// a new reading is only drawn from the main loop
+	Ui_SetCurrentPage(&sensorsPage);
+	Host_Drain();
+	memcpy(shown, fb, sizeof shown);
+	Ui_UpdateDHTData(-12.5f, 40);
+	hostTick += UI_FRAME_PERIOD_MS;
+	int sent = hostCommandCount;
+	Ui_Process();
+	HOST_CHECK(hostCommandCount == sent && !lcdIsBusy());
+	HOST_CHECK(memcmp(shown, fb, sizeof shown) == 0);
+	Ui_Idle();
+	Host_Drain();
+	printf("reading drawn by Ui_Idle() %d\n", memcmp(shown, fb, sizeof shown) != 0);
+	HOST_CHECK(memcmp(shown, fb, sizeof shown) != 0);
+
+	return hostFailures;
+}
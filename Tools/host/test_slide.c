@@ -0,0 +1,233 @@
+/*
+ * test_slide.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wojte
+ *
+ *  Slides between pages on an emulated ST7735S: the commands and pixels
+ *  sent are applied to a model of the controller RAM, the glass shows it
+ *  rotated by the scroll start line. Checks that the glass shows the two
+ *  pages side by side after every step and that a synchronized step sends
+ *  nothing before its tearing effect event, then the strip, then VSCSAD.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "host_hal.h"
+#include "ui.h"
+
+#define W 160
+#define H 128
+
+extern const Page homePage, settingsPage;
+#include "lcd_internal.h"
+
+static uint16_t ram[W * H], glass[W * H];
+static uint16_t oldPage[W * H], newPage[W * H];
+static int startLine;
+static uint32_t sinkRead;
+static int logRead;
+static int timeouts;
+
+/**
+ * @brief Applies the logged commands and the pixels sent since the last call to the RAM model.
+ */
+static void Feed()
+{
+	static int command = -1, count, x0, x1, y0, y1;
+	static int params[8];
+
+	for(; logRead < hostCommandCount; logRead++)
+	{
+		uint16_t byte = hostCommands[logRead];
+		if(byte & HOST_COMMAND)
+		{
+			command = byte & 0xff;
+			count = 0;
+			if(command == 0x2c)
+			{
+				for(int y = y0; y <= y1; y++)
+				{
+					for(int x = x0; x <= x1 && sinkRead + 1 < hostSinkBytes; x++, sinkRead += 2)
+					{
+						ram[y * W + x] = (hostSink[sinkRead] << 8) | hostSink[sinkRead + 1];
+					}
+				}
+			}
+			continue;
+		}
+
+		if(count < 8) params[count] = byte;
+		count++;
+		if(command == 0x2a && count == 4) { x0 = params[0] << 8 | params[1]; x1 = params[2] << 8 | params[3]; }
+		if(command == 0x2b && count == 4) { y0 = params[0] << 8 | params[1]; y1 = params[2] << 8 | params[3]; }
+		if(command == 0x37 && count == 2) { startLine = params[0] << 8 | params[1]; }
+	}
+}
+
+/**
+ * @brief Forgets what was fed, the logs start over.
+ */
+static void Rewind()
+{
+	hostCommandCount = 0;
+	hostSinkBytes = 0;
+	logRead = 0;
+	sinkRead = 0;
+}
+
+static void Show()
+{
+	// MV is set, the scan lines are the screen columns
+	for(int x = 0; x < W; x++)
+	{
+		for(int y = 0; y < H; y++)
+		{
+			glass[y * W + x] = ram[y * W + (x + startLine) % W];
+		}
+	}
+}
+
+/**
+ * @brief Counts the glass pixels that differ from the two pages slid by @p shown columns.
+ */
+static int GlassErrors(int shown, int direction)
+{
+	Show();
+	int errors = 0;
+	for(int x = 0; x < W; x++)
+	{
+		for(int y = 0; y < H; y++)
+		{
+			uint16_t expected;
+			if(direction > 0) expected = x < W - shown ? oldPage[y * W + x + shown] : newPage[y * W + x + shown - W];
+			else expected = x >= shown ? oldPage[y * W + x - shown] : newPage[y * W + W - shown + x];
+			errors += glass[y * W + x] != expected;
+		}
+	}
+	return errors;
+}
+
+/**
+ * @brief Completes the transfers, TE events only when @p vsync is set.
+ */
+static void Settle(uint8_t vsync)
+{
+	for(int i = 0; i < 1000 && lcdIsBusy(); i++)
+	{
+		if(Host_IsDmaPending()) Host_CompleteDma();
+		else if(vsync) Host_Vsync();
+		else
+		{
+			// TE line not wired, the armed flush times out
+			hostCycles += SystemCoreClock / 10;
+			lcdProcess();
+			timeouts++;
+		}
+	}
+	Feed();
+}
+
+/**
+ * @brief Opens a page and steps through the slide.
+ * @param mode 0 without TE events, 1 events timing out, 2 events delivered.
+ */
+static void Slide(int mode, int direction)
+{
+	const uint16_t *fb = lcdGetFrameBuffer();
+	memcpy(oldPage, fb, sizeof oldPage);
+	Rewind();
+
+	if(direction > 0) Ui_OpenPage(&settingsPage);
+	else Ui_GoBack(&homePage);
+	memcpy(newPage, fb, sizeof newPage);
+
+	// Ui_OpenPage() and Ui_GoBack() send the first step
+	int steps = 1, synced = 0, early = 0, errors = 0;
+	timeouts = 0;
+	int teOn = 0;
+	for(int tick = 0; tick < 400; tick++)
+	{
+		int before = hostCommandCount;
+		if(mode == 2 && lcdIsBusy() && !Host_IsDmaPending())
+		{
+			// armed: the step has not sent anything yet
+			early += Host_CommandAt(logRead, 0x2c) >= 0 || Host_CommandAt(logRead, 0x37) >= 0;
+			Host_Vsync();
+			Host_Vsync();
+			while(Host_IsDmaPending()) Host_CompleteDma();
+			int ramwr = Host_CommandAt(before, 0x2c);
+			int scroll = Host_CommandAt(before, 0x37);
+			synced += ramwr >= 0 && scroll > ramwr;
+		}
+		Settle(mode == 2);
+		teOn += Host_CommandAt(0, 0x35) >= 0;
+
+		int shown = direction > 0 ? startLine : (W - startLine) % W;
+		errors += GlassErrors(shown == 0 ? W : shown, direction);
+		if(shown == 0) break;
+
+		hostTick += UI_FRAME_PERIOD_MS;
+		Rewind();
+		Ui_Process();
+		Ui_Idle();
+		steps += lcdIsBusy() || hostCommandCount > 0;
+	}
+
+	printf("mode %d direction %d: steps %d glass errors %d synced %d early %d TEON %d timeouts %d\n",
+		   mode, direction, steps, errors, synced, early, teOn, timeouts);
+	HOST_CHECK(errors == 0);
+	HOST_CHECK(steps == UI_TRANSITION_STEPS);
+	HOST_CHECK(mode != 0 || teOn == 0);
+	HOST_CHECK(mode != 1 || timeouts >= UI_TRANSITION_STEPS);
+	HOST_CHECK(mode != 2 || (synced == UI_TRANSITION_STEPS && early == 0));
+	Show();
+	HOST_CHECK(memcmp(glass, fb, sizeof glass) == 0);
+}
+
+/**
+ * @brief Goes back while the first step of a slide waits for a TE event that never comes.
+ * @details Ui_GoBack() finishes the slide first and has to wait for the armed step.
+ */
+static void Interrupt()
+{
+	const uint16_t *fb = lcdGetFrameBuffer();
+	Rewind();
+	Ui_OpenPage(&settingsPage);
+	uint8_t armed = lcdIsBusy() && !Host_IsDmaPending();
+	Ui_GoBack(&homePage);
+	for(int tick = 0; tick < 2 * UI_TRANSITION_STEPS; tick++)
+	{
+		Settle(0);
+		hostTick += UI_FRAME_PERIOD_MS;
+		Ui_Process();
+		Ui_Idle();
+	}
+	Settle(0);
+	Show();
+
+	printf("interrupted: armed %d glass matches %d\n", armed, memcmp(glass, fb, sizeof glass) == 0);
+	HOST_CHECK(armed);
+	HOST_CHECK(memcmp(glass, fb, sizeof glass) == 0);
+}
+
+int main()
+{
+	Host_BringUp();
+	Ui_SetCurrentPage(&homePage);
+	Host_Drain();
+	Feed();
+
+	// a board without lcdSetTearingEffectSource() may not have the TE line
+	Slide(0, 1);
+	Slide(0, -1);
+
+	lcdSetTearingEffectSource(LCD_TE_SOURCE_PIN, 0);
+	Slide(1, 1);
+	Slide(1, -1);
+	Interrupt();
+	Slide(2, 1);
+	Slide(2, -1);
+
+	return hostFailures;
+}
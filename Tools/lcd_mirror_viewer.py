@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+lcd_mirror_viewer.py
+
+Receives the frames sent by Core/Src/lcd_mirror.c over the ST-Link virtual
+COM port and writes every reconstructed frame to a PNG or PPM file.
+The stream format is described in Core/Inc/lcd_mirror.h.
+
+Examples:
+    lcd_mirror_viewer.py --port /dev/ttyACM0 --shot
+    lcd_mirror_viewer.py --port COM5 --mirror 200 --format ppm
+    lcd_mirror_viewer.py --input capture.bin
+
+Serial ports need pyserial (pip install pyserial), files do not.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = b"LCDM"
+FRAME_FULL = 0
+FRAME_DELTA = 1
+
+
+class Reader:
+    """Blocking byte reader over a serial port or a file."""
+
+    def __init__(self, source):
+        self.source = source
+
+    def read(self, count):
+        data = b""
+        while len(data) < count:
+            chunk = self.source.read(count - len(data))
+            if not chunk:
+                raise EOFError
+            data += chunk
+        return data
+
+    def sync(self):
+        """Skips bytes up to and including the next frame magic."""
+        window = b""
+        while window != MAGIC:
+            window = (window + self.read(1))[-len(MAGIC):]
+
+
+def rgb565_to_rgb(pixel):
+    r = (pixel >> 11) & 0x1f
+    g = (pixel >> 5) & 0x3f
+    b = pixel & 0x1f
+    return bytes(((r * 255 + 15) // 31, (g * 255 + 31) // 63, (b * 255 + 15) // 31))
+
+
+def decode_rect(reader, frame, width, x, y, w, h):
+    """Unpacks the RLE packets of one rectangle into the frame (RGB565 list)."""
+    total = w * h
+    index = 0
+    while index < total:
+        header = reader.read(1)[0]
+        if header < 128:
+            count = header + 1
+            data = reader.read(count * 2)
+            pixels = struct.unpack(">%dH" % count, data)
+        else:
+            count = header - 126
+            pixels = struct.unpack(">H", reader.read(2)) * count
+        if index + count > total:
+            raise ValueError("packet runs past the rectangle")
+        for pixel in pixels:
+            frame[(y + index // w) * width + x + index % w] = pixel
+            index += 1
+
+
+def write_image(path, fmt, frame, width, height):
+    rows = [b"".join(rgb565_to_rgb(p) for p in frame[y * width:(y + 1) * width]) for y in range(height)]
+    with open(path, "wb") as out:
+        if fmt == "ppm":
+            out.write(b"P6\n%d %d\n255\n" % (width, height))
+            out.write(b"".join(rows))
+            return
+
+        def chunk(kind, data):
+            body = kind + data
+            return struct.pack(">I", len(data)) + body + struct.pack(">I", zlib.crc32(body) & 0xffffffff)
+
+        raw = b"".join(b"\x00" + row for row in rows)
+        out.write(b"\x89PNG\r\n\x1a\n")
+        out.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        out.write(chunk(b"IDAT", zlib.compress(raw, 9)))
+        out.write(chunk(b"IEND", b""))
+
+
+def run(reader, args):
+    frame = None
+    width = height = 0
+    expected_sequence = None
+    count = 0
+
+    while args.frames == 0 or count < args.frames:
+        try:
+            reader.sync()
+            kind, sequence, width_, height_, rects = struct.unpack("<BBHHH", reader.read(8))
+        except EOFError:
+            break
+
+        if kind == FRAME_FULL or frame is None or (width_, height_) != (width, height):
+            if kind == FRAME_DELTA:
+                print("delta frame %d without a base frame, waiting for a full one" % sequence, file=sys.stderr)
+            width, height = width_, height_
+            frame = [0] * (width * height)
+
+        if expected_sequence is not None and sequence != expected_sequence:
+            print("frames lost before %d, send SHOT to resynchronize" % sequence, file=sys.stderr)
+        expected_sequence = (sequence + 1) & 0xff
+
+        try:
+            for _ in range(rects):
+                x, y, w, h = struct.unpack("<HHHH", reader.read(8))
+                if x + w > width or y + h > height:
+                    raise ValueError("rectangle outside the screen")
+                decode_rect(reader, frame, width, x, y, w, h)
+        except ValueError as error:
+            print("frame %d corrupted (%s), skipped" % (sequence, error), file=sys.stderr)
+            continue
+        except EOFError:
+            break
+
+        path = os.path.join(args.output, "frame_%05d.%s" % (count, args.format))
+        write_image(path, args.format, frame, width, height)
+        print("%s %s %d rects" % (path, "full" if kind == FRAME_FULL else "delta", rects))
+        count += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Reconstructs LCD frames mirrored over UART.")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port of the ST-Link virtual COM port")
+    source.add_argument("--input", help="file with a captured stream")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--shot", action="store_true", help="request a full frame")
+    parser.add_argument("--mirror", type=int, metavar="MS", help="start mirroring with the given period, 0 stops it")
+    parser.add_argument("--frames", type=int, default=0, help="stop after this many frames (0 = run until EOF)")
+    parser.add_argument("--format", choices=("png", "ppm"), default="png")
+    parser.add_argument("--output", default=".", help="directory for the frame images")
+    args = parser.parse_args()
+
+    if args.input:
+        with open(args.input, "rb") as source_file:
+            run(Reader(source_file), args)
+        return
+
+    import serial
+
+    with serial.Serial(args.port, args.baud, timeout=None) as port:
+        if args.mirror is not None:
+            port.write(b"MIRROR %d\n" % args.mirror)
+        if args.shot:
+            port.write(b"SHOT\n")
+        if args.shot and args.mirror is None and args.frames == 0:
+            args.frames = 1
+        try:
+            run(Reader(port), args)
+        except KeyboardInterrupt:
+            if args.mirror:
+                port.write(b"MIRROR 0\n")
+
+
+if __name__ == "__main__":
+    main()